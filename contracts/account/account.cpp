@@ -20,12 +20,23 @@ void account::signin(name name, struct name service, string auth_token) {
 }
 
 void account::setnick(name name, string nickname) {
-   check(nickname.size() >= 6 && nickname.size() <= 24, "nickname has invalid length");
-   check(is_valid_nickname(nickname), "nickname contains invalid character");
-
    check(has_auth(system::default_account) || has_auth(name), "missing required authority");
 
    accounts_index acc(_self, _self.value);
+   set_nickname(acc, name, nickname);
+}
+
+void account::setnicks(std::vector<nick_item> items) {
+   require_auth(system::default_account);
+
+   accounts_index acc(_self, _self.value);
+   for (const auto& item: items)
+      set_nickname(acc, item.account, item.nickname);
+}
+
+void account::set_nickname(accounts_index& acc, name name, const string& nickname) {
+   check(nickname.size() >= 6 && nickname.size() <= 24, "nickname has invalid length");
+   check(is_valid_nickname(nickname), "nickname contains invalid character");
 
    const auto& idx = acc.get_index<"nickname"_n>();
    auto dup = idx.find(string_to_checksum256(nickname));
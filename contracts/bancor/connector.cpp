@@ -4,39 +4,34 @@
 namespace gxc {
 
 using connector = bancor::connector;
-using converted = bancor::connector::converted;
 
-converted connector::convert_to_smart(const extended_asset& from, const extended_symbol& to, bool reverse) {
-   const double S = token().get_supply(extended_symbol_code{to.get_symbol().code(), to.get_contract()}).quantity.amount; 
-   const double C = balance.amount;
-   const double dC = from.quantity.amount;
+asset connector::get_supply() const {
+   if (supply) return *supply;
+   return token().get_supply(extended_symbol_code{smart.get_symbol().code(), smart.get_contract()}).quantity;
+}
 
-   double dS = S * (std::pow(1. + dC / C, weight) - 1.);
-   if (dS < 0) dS = 0;
+void connector::update_price_cumulative(double current_supply) {
+   auto now = time_point_sec(current_time_point());
 
-   auto conversion_rate = ((int64_t)dS) / dS;
-   auto delta = asset{ from.quantity.amount - int64_t(from.quantity.amount * (1 - conversion_rate)), from.quantity.symbol };
+   if (!last_updated) {
+      price_cumulative.emplace(0.);
+      last_updated.emplace(now);
+      return;
+   }
 
-   if (!reverse) balance += delta;
-   else balance -= delta;
+   auto elapsed = now.sec_since_epoch() - last_updated->sec_since_epoch();
+   if (elapsed == 0) return;
 
-   return { {int64_t(dS), to}, delta, conversion_rate };
+   if (current_supply > 0) price_cumulative.emplace(*price_cumulative + get_price(current_supply) * elapsed);
+   last_updated.emplace(now);
 }
 
-converted connector::convert_from_smart(const extended_asset& from, const extended_symbol& to, bool reverse) {
-   const double C = balance.amount;
-   const double S = token().get_supply(extended_symbol_code{from.quantity.symbol.code(), from.contract}).quantity.amount; 
-   const double dS = -from.quantity.amount;
-
-   double dC = C * (std::pow(1. + dS / S, double(1) / weight) - 1.);
-   if (dC > 0) dC = 0;
-
-   auto delta = asset{ int64_t(-dC), balance.symbol };
-
-   if (!reverse) balance -= delta;
-   else balance += delta;
+void connector::apply(const bancor_math::quote& q) {
+   check(-q.smart < get_supply().amount, "not enough supply to sell");
+   update_price_cumulative(get_supply().amount);
 
-   return { {int64_t(-dC), to}, delta, ((int64_t)-dC) / (-dC) };
+   balance.amount += q.balance;
+   add_supply(q.smart);
 }
 
 }
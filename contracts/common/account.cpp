@@ -1,4 +1,5 @@
 #include <contracts/account.hpp>
+#include <contracts/system.hpp>
 
 namespace gxc {
 
@@ -14,6 +15,10 @@ void account::setnick(name _name, string nickname) {
    INLINE_ACTION_WRAPPER(account, setnick, _name, (_name)(nickname));
 }
 
+void account::setnicks(std::vector<nick_item> items) {
+   INLINE_ACTION_WRAPPER(account, setnicks, system::default_account, (items));
+}
+
 void account::setpartner(name _name, bool is_partner) {
    INLINE_ACTION_WRAPPER(account, setpartner, default_account, (_name)(is_partner));
 }
@@ -1,8 +1,6 @@
 #include <contracts/gacha.hpp>
 #include <contracts/account.hpp>
-#include <eosio/transaction.hpp>
-
-#include <eostd/crypto/drbg.hpp>
+#include <contracts/system.hpp>
 
 #include "../common/token.cpp"
 
@@ -14,37 +12,156 @@ void gacha::close(extended_name scheme) {
    scheme_index schm(_self, scheme.contract.value);
    const auto& it = schm.get(scheme.name.value);
 
+   schemestat_index stats(_self, scheme.contract.value);
+   const auto& st = stats.get(scheme.name.value);
+
    check(it.expiration < current_time_point(), "not expired gacha cannot be closed");
-   check(it.unresolved == 0, "unresolved gacha remains");
+   check(st.unresolved == 0, "unresolved gacha remains");
 
-   token().transfer(_self, basename(scheme.contract), it.budget - extended_asset{it.out, it.budget.contract}, "close gacha scheme");
+   token().transfer(_self, basename(scheme.contract), it.budget - extended_asset{st.out, it.budget.contract}, "close gacha scheme");
 
+   grade_index grades(_self, scheme.contract.value);
+   auto idx = grades.get_index<"scheme"_n>();
+   for (auto git = idx.lower_bound(_grade::scheme_key(scheme.name, 0)); git != idx.end() && git->scheme_name == scheme.name; ) {
+      git = idx.erase(git);
+   }
+
+   stats.erase(st);
    schm.erase(it);
 }
 
-void gacha::open(extended_name scheme, std::vector<grade> &grades, extended_asset budget, time_point_sec expiration, optional<uint8_t> precision, optional<uint32_t> deadline_sec) {
+void gacha::migrate(extended_name scheme) {
+   legacy_scheme_index legacy(_self, scheme.contract.value);
+   const auto& it = legacy.get(scheme.name.value, "scheme not found");
+
+   scheme_index schm(_self, scheme.contract.value);
+   check(schm.find(scheme.name.value) == schm.end(), "existing scheme name");
+
+   grade_index grds(_self, scheme.contract.value);
+   for (uint32_t index = 0; index < it.grades.size(); ++index) {
+      const auto& gr = it.grades[index];
+      grds.emplace(_self, [&](auto& g) {
+         g.id = grds.available_primary_key();
+         g.scheme_name = scheme.name;
+         g.key = _grade::key_of(gr.score);
+         g.index = index;
+         g.reward = gr.reward;
+         g.limit = gr.limit;
+         g.out_count = (index < it.out_count.size()) ? it.out_count[index] : 0;
+      });
+   }
+
+   schm.emplace(_self, [&](auto& s) {
+      s.scheme_name = it.scheme_name;
+      s.budget = it.budget;
+      s.expiration = it.expiration;
+      s.precision = it.precision;
+      s.deadline_sec = it.deadline_sec;
+   });
+
+   schemestat_index stats(_self, scheme.contract.value);
+   stats.emplace(_self, [&](auto& s) {
+      s.scheme_name = it.scheme_name;
+      s.out = it.out;
+      s.issued = it.issued;
+      s.unresolved = it.unresolved;
+   });
+
+   legacy.erase(it);
+}
+
+void gacha::migrategacha(uint32_t max_items) {
+   check(max_items > 0, "max_items should be positive");
+
+   legacy_gacha_index legacy(_self, _self.value);
+   check(legacy.begin() != legacy.end(), "no gacha to migrate");
+
+   due_index dues(_self, _self.value);
+
+   uint32_t migrated = 0;
+   for (auto it = legacy.begin(); it != legacy.end() && migrated < max_items; ++migrated) {
+      const auto& g = *it;
+
+      scheme_index schm(_self, g.scheme.contract.value);
+      if (schm.find(g.scheme.name.value) == schm.end()) migrate(g.scheme);
+
+      pending_index pnd(_self, g.scheme.contract.value);
+      gacha_index gch(_self, g.scheme.contract.value);
+      check(pnd.find(g.id) == pnd.end() && gch.find(g.id) == gch.end(), "existing gacha");
+
+      char zerobytes[32] = { 0, };
+      if (memcmp(g.oseed.data(), &zerobytes[0], 32) == 0) {
+         pnd.emplace(_self, [&](auto& c) {
+            c.id = g.id;
+            c.owner = g.owner;
+            c.scheme = g.scheme;
+            c.dseedhash = g.dseedhash;
+         });
+      } else {
+         // already counted as unresolved by the scheme, and drawn by its former deadline
+         gch.emplace(_self, [&](auto& c) {
+            c.id = g.id;
+            c.owner = g.owner;
+            c.scheme = g.scheme;
+            c.dseedhash = g.dseedhash;
+            c.oseed = g.oseed;
+            c.deadline = g.deadline;
+         });
+
+         dues.emplace(_self, [&](auto& d) {
+            d.key = dues.available_primary_key();
+            d.contract = g.scheme.contract;
+            d.id = g.id;
+            d.deadline = g.deadline;
+         });
+      }
+
+      it = legacy.erase(it);
+   }
+}
+
+void gacha::open(extended_name scheme, std::vector<grade> &grades, extended_asset budget, time_point_sec expiration, optional<uint8_t> precision, optional<uint32_t> deadline_sec, optional<bool> instant) {
    require_vauth(scheme.contract);
    check(account::is_partner(basename(scheme.contract)), "only partner account can create scheme");
 
    scheme_index schm(_self, scheme.contract.value);
    check(schm.find(scheme.name.value) == schm.end(), "existing scheme name");
 
+   legacy_scheme_index legacy(_self, scheme.contract.value);
+   check(legacy.find(scheme.name.value) == legacy.end(), "existing scheme name");
+
+   grade_index grds(_self, scheme.contract.value);
+
    const grade* prev = nullptr;
-   for (const auto& it: grades) {
+   for (uint32_t index = 0; index < grades.size(); ++index) {
+      const auto& it = grades[index];
       check(!prev || it.score < prev->score, "grades should be sorted in descending order by score");
       prev = &it;
+
+      grds.emplace(_self, [&](auto& g) {
+         g.id = grds.available_primary_key();
+         g.scheme_name = scheme.name;
+         g.key = _grade::key_of(it.score);
+         g.index = index;
+         g.reward = it.reward;
+         g.limit = it.limit;
+      });
    }
 
    schm.emplace(_self, [&](auto& s) {
       s.scheme_name = scheme.name;
-      s.grades = grades;
       s.budget = budget;
       s.expiration = expiration;
       check(!precision || *precision <= 4, "precision cannot exceed 4 bytes");
       s.precision = (precision) ? *precision : 1;
       s.deadline_sec = (deadline_sec) ? *deadline_sec : 60 * 60 * 24 * 7;
+      s.instant = (instant) ? *instant : false;
+   });
+
+   schemestat_index stats(_self, scheme.contract.value);
+   stats.emplace(_self, [&](auto& s) {
+      s.scheme_name = scheme.name;
       s.out.symbol = budget.quantity.symbol;
-      s.out_count.resize(grades.size());
    });
 
    auto _token = token();
@@ -52,7 +169,7 @@ void gacha::open(extended_name scheme, std::vector<grade> &grades, extended_asse
    _token.transfer(basename(scheme.contract), _self, budget, "open gacha scheme");
 }
 
-void gacha::issue(name to, extended_name scheme, checksum256 dseedhash, optional<uint64_t> id) {
+void gacha::issue(name to, extended_name scheme, checksum256 dseedhash, optional<uint64_t> id, optional<uint16_t> pulls, optional<seeds> instant) {
    require_vauth(scheme.contract);
 
    scheme_index schm(_self, scheme.contract.value);
@@ -60,162 +177,438 @@ void gacha::issue(name to, extended_name scheme, checksum256 dseedhash, optional
 
    check(sit != schm.end(), "scheme not found");
    check(sit->expiration > current_time_point(), "scheme expired");
-   check(sit->out <= sit->budget.quantity, "budget exhausted");
 
-   gacha_index gch(_self, _self.value);
+   schemestat_index stats(_self, scheme.contract.value);
+   const auto& st = stats.get(scheme.name.value);
+   check(st.out <= sit->budget.quantity, "budget exhausted");
 
    auto gacha_id = (id) ? *id : _gacha::hash(scheme, dseedhash);
-   auto git = gch.find(gacha_id);
-   check(git == gch.end(), "existing gacha");
 
-   gch.emplace(_self, [&](auto& c) {
-      c.id = gacha_id;
+   if (!sit->instant) {
+      check(!instant, "seeds are only for instant scheme");
+
+      pending_index pnd(_self, scheme.contract.value);
+      auto issued = issue_one(pnd, to, scheme, gacha_id, dseedhash, pulls);
+
+      stats.modify(st, same_payer, [&](auto& s) {
+         s.issued += issued;
+      });
+      return;
+   }
+
+   // Instant draw mixes dseed, oseed and the ids of recent blocks kept by the system contract,
+   // and all of them are known before the transaction is included. Whoever signs last, the dealer
+   // or the owner, can compute the outcome in advance, and can withhold the transaction until later
+   // block ids give a better one; the dealer can also pick another dseed. Mixing several blocks
+   // only makes a single block producer less decisive. So an instant scheme trusts both parties
+   // not to grind, and commit and reveal is the only way to draw without that trust.
+   //
+   // Ids are explicit and drawn once per scheme contract.
+   check(!!instant, "instant scheme requires seeds");
+   check(!!id, "instant scheme requires id");
+   check(!pulls || (*pulls > 0 && *pulls <= max_pulls), "invalid number of pulls");
+   require_auth(to);
+
+   auto data = instant->dseed.extract_as_byte_array();
+   auto hash = eosio::sha256(reinterpret_cast<const char*>(data.data()), data.size());
+   check(memcmp((const void*)dseedhash.data(), (const void*)hash.data(), 32) == 0, "hash mismatch");
+
+   instant_index instants(_self, scheme.contract.value);
+   pending_index pnd(_self, scheme.contract.value);
+   gacha_index gch(_self, scheme.contract.value);
+   check(instants.find(gacha_id) == instants.end() && pnd.find(gacha_id) == pnd.end() && gch.find(gacha_id) == gch.end(), "existing gacha");
+
+   instants.emplace(_self, [&](auto& i) {
+      i.id = gacha_id;
+   });
+
+   // dseed || oseed || ids of recent blocks from the last one
+   eostd::byte seed[64 + 32 * gacha_math::instant_blocks];
+   datastream<uint8_t*> ds(seed, sizeof(seed));
+   ds << data;
+   ds << instant->oseed.extract_as_byte_array();
+   for (uint32_t age = 0; age < gacha_math::instant_blocks; ++age) {
+      auto blk = system::get_recent_block(age);
+      check(!!blk, "block id not available");
+      ds << blk->id.extract_as_byte_array();
+   }
+
+   eostd::hash_drbg drbg(seed, sizeof(seed));
+
+   reserve_reward(to, sit->budget.get_extended_symbol());
+
+   payouts po;
+   auto issued = (pulls) ? *pulls : 1;
+   auto out = roll(scheme, sit->budget - extended_asset{st.out, sit->budget.contract}, sit->precision, to, gacha_id, issued, &drbg, po);
+
+   stats.modify(st, same_payer, [&](auto& s) {
+      s.issued += issued;
+      s.out += out;
+      check(s.out <= sit->budget.quantity, "budget exceeded");
+   });
+
+   credit(po);
+}
+
+void gacha::issuebatch(extended_name scheme, checksum256 root, std::vector<ticket>& tickets) {
+   require_vauth(scheme.contract);
+   check(tickets.size() > 0, "empty batch");
+
+   scheme_index schm(_self, scheme.contract.value);
+   auto sit = schm.find(scheme.name.value);
+
+   check(sit != schm.end(), "scheme not found");
+   check(sit->expiration > current_time_point(), "scheme expired");
+   check(!sit->instant, "instant scheme cannot issue batch");
+
+   schemestat_index stats(_self, scheme.contract.value);
+   const auto& st = stats.get(scheme.name.value);
+   check(st.out <= sit->budget.quantity, "budget exhausted");
+
+   batch_index batches(_self, scheme.contract.value);
+   auto batch_id = _gacha::hash(scheme, root);
+   check(batches.find(batch_id) == batches.end(), "existing batch");
+
+   batches.emplace(_self, [&](auto& b) {
+      b.id = batch_id;
+      b.root = root;
+      b.size = static_cast<uint32_t>(tickets.size());
+      b.remaining = b.size;
+   });
+
+   pending_index pnd(_self, scheme.contract.value);
+   uint32_t issued = 0;
+
+   for (uint32_t index = 0; index < tickets.size(); ++index) {
+      const auto& t = tickets[index];
+      issued += issue_one(pnd, t.to, scheme, (t.id) ? *t.id : _gacha::hash(scheme, root, index), leaf{batch_id, index}, t.pulls);
+   }
+
+   stats.modify(st, same_payer, [&](auto& s) {
+      s.issued += issued;
+   });
+}
+
+uint16_t gacha::issue_one(pending_index& pnd, name to, extended_name scheme, uint64_t id, std::variant<checksum256, leaf> dseedhash, optional<uint16_t> pulls) {
+   check(!pulls || (*pulls > 0 && *pulls <= max_pulls), "invalid number of pulls");
+
+   gacha_index gch(_self, scheme.contract.value);
+   instant_index instants(_self, scheme.contract.value);
+   check(pnd.find(id) == pnd.end() && gch.find(id) == gch.end() && instants.find(id) == instants.end(), "existing gacha");
+
+   // keeps ids of gacha not migrated yet, which are moved into the scope of their scheme contract
+   legacy_gacha_index legacy(_self, _self.value);
+   check(legacy.find(id) == legacy.end(), "existing gacha");
+
+   pnd.emplace(_self, [&](auto& c) {
+      c.id = id;
       c.owner = to;
       c.scheme = scheme;
       c.dseedhash = dseedhash;
+      c.pulls = (pulls) ? *pulls : 1;
    });
 
-   schm.modify(sit, same_payer, [&](auto& s) {
-      s.issued++;
-   });
+   return (pulls) ? *pulls : 1;
 }
 
-void gacha::setoseed(uint64_t id, checksum256 oseed) {
+void gacha::setoseed(name contract, uint64_t id, checksum256 oseed) {
    char zerobytes[32] = { 0, };
+   check(memcmp(oseed.data(), &zerobytes[0], 32), "invalid oseed");
 
-   gacha_index gch(_self, _self.value);
-   const auto& git = gch.get(id);
+   pending_index pnd(_self, contract.value);
+   gacha_index gch(_self, contract.value);
 
-   require_auth(git.owner);
-   check(memcmp(git.oseed.data(), &zerobytes[0], 32) == 0, "oseed is already set");
+   auto pit = pnd.find(id);
+   check(pit != pnd.end() || gch.find(id) == gch.end(), "oseed is already set");
+   check(pit != pnd.end(), "gacha not found");
 
-   scheme_index schm(_self, git.scheme.contract.value);
-   const auto& sit = schm.get(git.scheme.name.value);
+   require_auth(pit->owner);
+
+   scheme_index schm(_self, pit->scheme.contract.value);
+   const auto& sit = schm.get(pit->scheme.name.value);
+
+   auto deadline = current_time_point() + seconds(sit.deadline_sec);
+
+   reserve_reward(pit->owner, sit.budget.get_extended_symbol());
 
-   gch.modify(git, same_payer, [&](auto& c) {
+   gch.emplace(_self, [&](auto& c) {
+      c.id = pit->id;
+      c.owner = pit->owner;
+      c.scheme = pit->scheme;
+      c.dseedhash = pit->dseedhash;
       c.oseed = oseed;
-      c.deadline = current_time_point() + seconds(sit.deadline_sec);
+      c.deadline = deadline;
+      c.pulls = pit->pulls;
+   });
+
+   due_index dues(_self, _self.value);
+   dues.emplace(_self, [&](auto& d) {
+      d.key = dues.available_primary_key();
+      d.contract = contract;
+      d.id = id;
+      d.deadline = deadline;
    });
 
-   schm.modify(sit, same_payer, [&](auto& s) {
+   schemestat_index stats(_self, pit->scheme.contract.value);
+   stats.modify(stats.get(pit->scheme.name.value), same_payer, [&](auto& s) {
       s.unresolved++;
    });
 
-   refresh_schedule();
+   pnd.erase(pit);
 }
 
-void gacha::setdseed(uint64_t id, checksum256 dseed) {
-   draw(id, dseed);
+void gacha::setdseed(name contract, uint64_t id, checksum256 dseed) {
+   payouts po;
+   draw(contract, id, dseed, {}, po);
+   credit(po);
+}
 
-   refresh_schedule();
+void gacha::reveal(name contract, std::vector<reveal_item>& items) {
+   payouts po;
+   for (const auto& it: items) {
+      draw(contract, it.id, it.dseed, it.proof, po);
+   }
+   credit(po);
 }
 
-void gacha::refresh_schedule() {
-   gacha_index gch(_self, _self.value);
-   auto deadline = gch.get_index<"deadline"_n>();
-   auto it = deadline.begin();
+void gacha::resolve(uint32_t max_items) {
+   check(max_items > 0, "max_items should be positive");
 
-   cancel_deferred(_self.value);
+   due_index dues(_self, _self.value);
+   auto deadline = dues.get_index<"deadline"_n>();
 
-   if (it != deadline.end()) {
-      auto timeleft = (it->deadline - current_time_point()).to_seconds();
-      if (timeleft <= 0) {
-         action_wrapper<"resolve"_n, &gacha::resolve>(_self, {_self, "active"_n}).send();
-      } else {
-         transaction out;
-         out.actions.emplace_back(permission_level{_self, "active"_n}, _self, "resolve"_n, std::make_tuple());
-         out.delay_sec = static_cast<uint32_t>(timeleft);
-         out.send(_self.value, _self, true);
-      }
+   // draw erases the due entry, so every iteration starts over from the earliest deadline,
+   // and the next call picks up whatever this one left because of `max_items`
+   payouts po;
+   uint32_t resolved = 0;
+   for (auto it = deadline.begin(); it != deadline.end() && resolved < max_items; it = deadline.begin(), ++resolved) {
+      if (it->deadline > current_time_point()) break;
+
+      resolve_one(it->contract, it->id, po);
    }
+
+   check(resolved > 0, "no expired gacha");
+
+   // rewards are credited rather than transferred, so no owner can make resolve fail
+   credit(po);
 }
 
-void gacha::resolve() {
-   require_auth(_self);
+void gacha::resolve_one(name contract, uint64_t id, payouts& po) {
+   draw(contract, id, nullopt, {}, po);
+}
 
-   gacha_index gch(_self, _self.value);
-   auto deadline = gch.get_index<"deadline"_n>();
+void gacha::claim(name owner) {
+   require_auth(owner);
 
-   auto it = deadline.begin();
+   reward_index rewards(_self, owner.value);
 
-   for ( ; it != deadline.end(); it = deadline.begin()) {
-      const auto& git = *it;
-      if (git.deadline > current_time_point()) break;
+   // rows still reserved for gacha not drawn yet are released too
+   bool claimed = false;
+   for (auto it = rewards.begin(); it != rewards.end(); ) {
+      if (it->balance.quantity.amount > 0) {
+         token().transfer(_self, owner, it->balance, "gacha reward");
+         claimed = true;
+      }
+      it = rewards.erase(it);
+   }
+
+   check(claimed, "no reward to claim");
+}
+
+void gacha::reserve_reward(name owner, const extended_symbol& symbol) {
+   reward_index rewards(_self, owner.value);
+   auto key = std::hash<extended_symbol_code>()(extended_symbol_code{symbol.get_symbol().code(), symbol.get_contract()});
+   if (rewards.find(key) == rewards.end()) {
+      rewards.emplace(owner, [&](auto& r) {
+         r.balance = extended_asset{0, symbol};
+      });
+   }
+}
 
-      resolve_one(git.id);
+void gacha::credit(const payouts& po) {
+   for (const auto& p: po.amounts) {
+      auto value = extended_asset{asset{p.second, p.first.second.get_symbol()}, p.first.second.get_contract()};
+
+      reward_index rewards(_self, p.first.first.value);
+      auto it = rewards.find(std::hash<extended_symbol_code>()(extended_symbol_code{value.quantity.symbol.code(), value.contract}));
+      if (it == rewards.end()) {
+         // not reserved if claimed before draw or opened before reservation, and resolve can't charge owner
+         rewards.emplace(_self, [&](auto& r) {
+            r.balance = value;
+         });
+      } else {
+         rewards.modify(it, same_payer, [&](auto& r) {
+            r.balance += value;
+         });
+      }
    }
 
-   refresh_schedule();
+   for (const auto& r: po.results) {
+      action_wrapper<"drawresult"_n, &gacha::drawresult>(_self, {_self, "active"_n}).send(r.first, r.second);
+   }
 }
 
-void gacha::resolve_one(uint64_t id) {
-   draw(id);
+void gacha::check_dseed(const _gacha& g, const checksum256& dseed, const vector<checksum256>& proof) {
+   auto data = dseed.extract_as_byte_array();
+   auto node = eosio::sha256(reinterpret_cast<const char*>(data.data()), data.size());
+
+   if (std::holds_alternative<checksum256>(g.dseedhash)) {
+      check(proof.empty(), "proof is not required");
+      check(memcmp((const void*)std::get<checksum256>(g.dseedhash).data(), (const void*)node.data(), 32) == 0, "hash mismatch");
+      return;
+   }
+
+   const auto& l = std::get<leaf>(g.dseedhash);
+   batch_index batches(_self, g.scheme.contract.value);
+   const auto& b = batches.get(l.batch);
+   check(proof.size() == b.depth(), "invalid proof length");
+
+   // siblings from leaf to root, left or right by bits of leaf index
+   auto index = l.index;
+   for (const auto& sibling: proof) {
+      std::array<uint8_t,64> buf;
+      auto lhs = (index & 1) ? sibling.extract_as_byte_array() : node.extract_as_byte_array();
+      auto rhs = (index & 1) ? node.extract_as_byte_array() : sibling.extract_as_byte_array();
+      std::copy(lhs.begin(), lhs.end(), buf.begin());
+      std::copy(rhs.begin(), rhs.end(), buf.begin() + 32);
+      node = eosio::sha256(reinterpret_cast<const char*>(buf.data()), buf.size());
+      index >>= 1;
+   }
+   check(memcmp((const void*)b.root.data(), (const void*)node.data(), 32) == 0, "hash mismatch");
 }
 
-void gacha::draw(uint64_t id, optional<checksum256> dseed) {
-   gacha_index gch(_self, _self.value);
-   const auto& git = gch.get(id);
+void gacha::draw(name contract, uint64_t id, optional<checksum256> dseed, const vector<checksum256>& proof, payouts& po) {
+   gacha_index gch(_self, contract.value);
+   auto it = gch.find(id);
+   if (it == gch.end()) {
+      pending_index pnd(_self, contract.value);
+      check(pnd.find(id) == pnd.end(), "oseed is not set");
+      check(false, "gacha not found");
+   }
+   const auto& git = *it;
 
-   check(has_auth(_self) || (dseed &&  has_vauth(git.scheme.contract)), "missing required authority");
+   if (dseed) {
+      check(has_auth(_self) || has_vauth(git.scheme.contract), "missing required authority");
+   } else {
+      check(git.deadline <= current_time_point(), "gacha not expired");
+   }
 
    scheme_index schm(_self, git.scheme.contract.value);
    const auto& sit = schm.get(git.scheme.name.value);
 
-   uint32_t grade = 0;
-   int64_t score = 0;
+   schemestat_index stats(_self, git.scheme.contract.value);
+   const auto& st = stats.get(git.scheme.name.value);
+
+   optional<eostd::hash_drbg> drbg;
 
    if (dseed) {
-      char zerobytes[32] = { 0, };
-      check(memcmp(git.oseed.data(), &zerobytes[0], 32), "oseed is not set");
+      check_dseed(git, *dseed, proof);
 
       auto data = dseed->extract_as_byte_array();
-      auto hash = eosio::sha256(reinterpret_cast<const char*>(data.data()), data.size());
-      check(memcmp((const void*)git.dseedhash.data(), (const void*)hash.data(), 32) == 0, "hash mismatch");
 
       eostd::byte seed[64];
       datastream<uint8_t*> ds(seed, sizeof(seed));
       ds << data;
       ds << git.oseed.extract_as_byte_array();
 
-      eostd::byte result[4];
-      eostd::hash_drbg drbg(seed, sizeof(seed));
-      drbg.generate_block(&result[0], sizeof(result));
+      drbg.emplace(seed, sizeof(seed));
+   }
+
+   auto out = roll(git.scheme, sit.budget - extended_asset{st.out, sit.budget.contract}, sit.precision, git.owner, git.id, git.pulls, (drbg) ? &*drbg : nullptr, po);
 
-      memcpy((void*)&score, (const void*)result, sit.precision);
+   stats.modify(st, same_payer, [&](auto& s) {
+      s.out += out;
+      check(s.out <= sit.budget.quantity, "budget exceeded");
+      s.unresolved--;
+   });
 
-      for (auto it: sit.grades) {
-         if (score >= it.score && (!it.limit || sit.out_count[grade] < *(it.limit)))
-            break;
-         grade++;
+   if (std::holds_alternative<leaf>(git.dseedhash)) {
+      batch_index batches(_self, contract.value);
+      const auto& b = batches.get(std::get<leaf>(git.dseedhash).batch);
+      if (b.remaining > 1) {
+         batches.modify(b, same_payer, [&](auto& r) {
+            r.remaining--;
+         });
+      } else {
+         batches.erase(b);
       }
-   } else {
-      score = -1;
    }
 
-   if (grade >= sit.grades.size()) {
-      action_wrapper<"raincheck"_n, &gacha::raincheck>(_self, {_self, "active"_n}).send(git.owner, git.id, score);
-   } else {
-      auto reward = extended_asset{sit.grades[grade].reward, sit.budget.contract};
+   due_index dues(_self, _self.value);
+   auto gacha_due = dues.get_index<"gacha"_n>();
+   auto dit = gacha_due.find(due::gacha_key(contract, id));
+   check(dit != gacha_due.end() && dit->contract == contract && dit->id == id, "due not found");
+   gacha_due.erase(dit);
 
-      action_wrapper<"winreward"_n, &gacha::winreward>(_self, {_self, "active"_n}).send(git.owner, git.id, score, reward);
-      token().transfer(_self, git.owner, reward, "");
+   gch.erase(git);
+}
 
-      schm.modify(sit, same_payer, [&](auto& s) {
-         s.out += sit.grades[grade].reward;
-         s.out_count[grade]++;
-         check(s.out <= s.budget.quantity, "budget exceeded");
-         s.unresolved--;
-      });
+asset gacha::roll(extended_name scheme, const extended_asset& left, uint8_t precision, name owner, uint64_t id, uint16_t pulls, eostd::hash_drbg* drbg, payouts& po) {
+   grade_index grades(_self, scheme.contract.value);
+   auto idx = grades.get_index<"scheme"_n>();
+   const auto last = idx.upper_bound(_grade::scheme_key(scheme.name, std::numeric_limits<uint64_t>::max()));
+
+   // number of rewards drawn in this call per grade id
+   std::map<uint64_t, uint32_t> drawn;
+   auto drawn_of = [&](uint64_t gid) -> uint32_t {
+      auto dit = drawn.find(gid);
+      return (dit != drawn.end()) ? dit->second : 0;
+   };
+
+   asset out{0, left.quantity.symbol};
+   auto& results = po.results[owner];
+
+   // A grade is skipped once its limit is reached, so a drawn score gets the same grade as before,
+   // and the draw aborts with "budget exceeded" if the budget can't pay it. Without drbg there is no score
+   // to keep, and grades the rest of budget can't pay are skipped too, so resolve never aborts on budget.
+   auto is_exhausted = [&](const auto& g) {
+      return g.is_exhausted(drawn_of(g.id)) || (!drbg && g.reward > left.quantity - out);
+   };
+
+   // every pull advances the same drbg stream, so the first pull equals a single-pull gacha
+   for (uint16_t pull = 0; pull < pulls; ++pull) {
+      auto grade = last;
+      int64_t score = 0;
+
+      if (drbg) {
+         eostd::byte result[gacha_math::bytes_per_pull];
+         drbg->generate_block(&result[0], sizeof(result));
+
+         score = gacha_math::to_score(reinterpret_cast<const uint8_t*>(result), precision);
+
+         // highest grade not above score, falling back to lower grades
+         grade = gacha_math::select(idx.lower_bound(_grade::scheme_key(scheme.name, _grade::key_of(static_cast<uint32_t>(score)))), last, is_exhausted);
+      } else {
+         // dealer didn't reveal in time, so owner gets the highest grade still available
+         score = -1;
+         grade = gacha_math::select(idx.lower_bound(_grade::scheme_key(scheme.name, 0)), last, is_exhausted);
+      }
+
+      if (grade == last) {
+         results.push_back({id, score, nullopt});
+      } else {
+         auto reward = extended_asset{grade->reward, left.contract};
+         results.push_back({id, score, reward});
+
+         out += reward.quantity;
+         drawn[grade->id]++;
+      }
    }
 
-   gch.erase(git);
-}
+   if (out.amount > 0) {
+      po.amounts[{owner, extended_symbol{out.symbol, left.contract}}] += out.amount;
+   }
 
-void gacha::winreward(name owner, uint64_t id, int64_t score, extended_asset value) {
-   require_auth(_self);
+   for (const auto& d: drawn) {
+      grades.modify(grades.get(d.first), same_payer, [&](auto& g) {
+         g.out_count += d.second;
+      });
+   }
+
+   return out;
 }
 
-void gacha::raincheck(name owner, uint64_t id, int64_t score) {
+void gacha::drawresult(name owner, std::vector<pull_result>& results) {
    require_auth(_self);
 }
 
@@ -1,6 +1,5 @@
 #include <contracts/htlc.hpp>
 #include <eosio/system.hpp>
-#include <eostd/hex.hpp>
 
 #include "../common/token.cpp"
 
@@ -12,85 +11,313 @@ constexpr name system_account{"gxc"_n};
 constexpr name null_account{"gxc.null"_n};
 constexpr name vault_account{"gxc.vault"_n};
 
-void htlc::newcontract(name owner, string contract_name, std::variant<name, checksum160> recipient, extended_asset value, checksum256 hashlock, time_point_sec timelock) {
-   require_auth(owner);
+namespace {
 
-   check(std::holds_alternative<checksum160>(recipient) || (owner == vault_account), "invalid recipient");
+// memo formatted in a fixed buffer, so that it is allocated once when passed to transfer
+class memo_buffer {
+public:
+   memo_buffer& operator<<(const char* s) { return append(s, strlen(s)); }
+   memo_buffer& operator<<(const string& s) { return append(s.data(), s.size()); }
 
-   htlc_index idx(_self, owner.value);
-   check(idx.find(std::hash<std::string>()(contract_name)) == idx.end(), "existing contract name");
+   memo_buffer& operator<<(name n) {
+      char buf[13];
+      auto end = n.write_as_string(buf, buf + sizeof(buf));
+      return append(buf, end - buf);
+   }
 
-   config_index cfg(_self, value.contract.value);
-   auto it = cfg.find(value.quantity.symbol.code().raw());
+   memo_buffer& operator<<(uint64_t v) {
+      char buf[20];
+      auto p = buf + sizeof(buf);
+      do { *--p = '0' + v % 10; v /= 10; } while (v);
+      return append(p, buf + sizeof(buf) - p);
+   }
 
-   bool constrained = owner != vault_account && it != cfg.end();
-   auto min_amount = (constrained) ? extended_asset(it->min_amount, value.contract) : extended_asset(0, value.get_extended_symbol());
-   auto min_duration = (constrained) ? it->min_duration : 0;
-
-   check(value >= min_amount, "specified amount is not enough");
-   check(timelock >= current_time_point() + seconds(min_duration), "the expiration time should be in the future");
-
-   idx.emplace(owner, [&](auto& l) {
-      l.contract_name = contract_name;
-      l.recipient = recipient;
-      l.value = value;
-      l.hashlock = hashlock;
-      l.timelock = timelock;
-   });
+   memo_buffer& hex(const uint8_t* data, size_t size) {
+      static const char digits[] = "0123456789abcdef";
+      check(_size + size * 2 <= sizeof(_buf), "memo has more than 256 bytes");
+      for (size_t i = 0; i < size; ++i) {
+         _buf[_size++] = digits[data[i] >> 4];
+         _buf[_size++] = digits[data[i] & 0xf];
+      }
+      return *this;
+   }
+
+   // `: ` followed by contract name or id, if any
+   memo_buffer& label(const string& contract_name, const std::optional<uint64_t>& id) {
+      if (id) return *this << ": " << *id;
+      if (contract_name.size()) return *this << ": " << contract_name;
+      return *this;
+   }
+
+   memo_buffer& label(const htlc::lock_contract& c) { return label(c.contract_name, std::nullopt); }
+   memo_buffer& label(const htlc::id_contract& c) { return label(string(), c.id); }
+
+   string str() const { return string(_buf, _size); }
+
+private:
+   memo_buffer& append(const char* s, size_t size) {
+      check(_size + size <= sizeof(_buf), "memo has more than 256 bytes");
+      memcpy(_buf + _size, s, size);
+      _size += size;
+      return *this;
+   }
+
+   char   _buf[256];
+   size_t _size = 0;
+};
+
+// trailing id of actions, for key_of and memo
+template<typename T>
+std::optional<T> to_optional(const eostd::binary_extension<T>& v) {
+   return (v) ? std::optional<T>(*v) : std::nullopt;
+}
+
+}
+
+void htlc::newcontract(name owner, string contract_name, std::variant<name, checksum160> recipient, extended_asset value, checksum256 hashlock, time_point_sec timelock, eostd::binary_extension<uint64_t> id) {
+   require_auth(owner);
+
+   htlc_index idx(_self, owner.value);
+   htlcid_index ids(_self, owner.value);
+   expiry_index expiries(_self, _self.value);
+   lock(idx, ids, expiries, owner, {contract_name, recipient, value, hashlock, timelock, to_optional(id)}, get_constraint(owner, value.get_extended_symbol()));
 
    if (owner != vault_account) {
       token _token;
       _token.authorization = {{_self, "active"_n}};
-      _token.transfer(owner, _self, value, "htlc created by " + owner.to_string() + (contract_name.size() ? ": " : "") + contract_name);
+      _token.transfer(owner, _self, value, (memo_buffer() << "htlc created by " << owner).label(contract_name, to_optional(id)).str());
    }
 }
 
-void htlc::withdraw(name owner, string contract_name, checksum256 preimage) {
+void htlc::newcontracts(name owner, std::vector<lock_item> items) {
+   require_auth(owner);
+   check(items.size() > 0, "no contract to create");
+
    htlc_index idx(_self, owner.value);
-   const auto& it = idx.get(std::hash<std::string>()(contract_name));
-   check(it.timelock >= current_time_point(), "contract is expired");
+   htlcid_index ids(_self, owner.value);
+   expiry_index expiries(_self, _self.value);
 
-   // `preimage` works as a key here.
-   //require_auth(it.recipient);
+   // config is read once per token, and locked value is summed up to be pulled at once,
+   // where asset checks the sum for overflow
+   std::map<extended_symbol, std::pair<constraint, asset>> totals;
+   for (const auto& item: items) {
+      auto symbol = item.value.get_extended_symbol();
+      auto it = totals.find(symbol);
+      if (it == totals.end()) {
+         it = totals.emplace(symbol, std::make_pair(get_constraint(owner, symbol), asset{0, symbol.get_symbol()})).first;
+      }
+      lock(idx, ids, expiries, owner, item, it->second.first);
+      it->second.second += item.value.quantity;
+   }
 
-   auto data = preimage.extract_as_byte_array();
-   auto hash = eosio::sha256(reinterpret_cast<const char*>(data.data()), data.size());
-   check(memcmp((const void*)it.hashlock.data(), (const void*)hash.data(), 32) == 0, "invalid preimage");
+   if (owner != vault_account) {
+      token _token;
+      _token.authorization = {{_self, "active"_n}};
+      auto memo = (memo_buffer() << "htlc created by " << owner).str();
+      for (const auto& t: totals) {
+         _token.transfer(owner, _self, extended_asset{t.second.second, t.first.get_contract()}, memo);
+      }
+   }
+}
+
+htlc::constraint htlc::get_constraint(name owner, const extended_symbol& symbol) {
+   config_index cfg(_self, symbol.get_contract().value);
+   auto it = cfg.find(symbol.get_symbol().code().raw());
+
+   bool constrained = owner != vault_account && it != cfg.end();
+   return {
+      (constrained) ? extended_asset(it->min_amount, symbol.get_contract()) : extended_asset(0, symbol),
+      (constrained) ? it->min_duration : 0
+   };
+}
+
+void htlc::lock(htlc_index& idx, htlcid_index& ids, expiry_index& expiries, name owner, const lock_item& item, const constraint& c) {
+   check(std::holds_alternative<checksum160>(item.recipient) || (owner == vault_account), "invalid recipient");
+   check(!item.id || item.contract_name.empty(), "contract name should be empty with id");
+
+   auto id = lock_contract::key_of(item.contract_name, item.id);
+   check(idx.find(id) == idx.end() && ids.find(id) == ids.end(), "existing contract name");
+
+   check(item.value >= c.min_amount, "specified amount is not enough");
+   check(item.timelock >= current_time_point() + seconds(c.min_duration), "the expiration time should be in the future");
+
+   if (item.id) {
+      ids.emplace(owner, [&](auto& l) {
+         l.id = *item.id;
+         l.recipient = item.recipient;
+         l.value = item.value;
+         l.hashlock = item.hashlock;
+         l.timelock = item.timelock;
+      });
+   } else {
+      idx.emplace(owner, [&](auto& l) {
+         l.contract_name = item.contract_name;
+         l.recipient = item.recipient;
+         l.value = item.value;
+         l.hashlock = item.hashlock;
+         l.timelock = item.timelock;
+      });
+   }
 
+   expiries.emplace(owner, [&](auto& e) {
+      e.key = expiries.available_primary_key();
+      e.owner = owner;
+      e.id = id;
+      e.timelock = item.timelock;
+      e.hashlock = item.hashlock;
+   });
+}
+
+template<typename F>
+void htlc::visit(name owner, uint64_t key, F&& f) {
+   htlcid_index ids(_self, owner.value);
+   auto it = ids.find(key);
+   if (it != ids.end()) {
+      f(ids, *it);
+      return;
+   }
+
+   htlc_index idx(_self, owner.value);
+   f(idx, idx.get(key));
+}
+
+template<typename Contract>
+void htlc::release(name owner, const Contract& c) {
    token _token;
-   auto processed_msg = "htlc processed from " + owner.to_string() + (contract_name.size() ? ": " : "") + contract_name;
+   auto processed_msg = (memo_buffer() << "htlc processed from " << owner).label(c).str();
 
-   if (std::holds_alternative<name>(it.recipient)) {
+   if (std::holds_alternative<name>(c.recipient)) {
       check(owner == vault_account, "must not happen");
-      if (it.value.contract == system_account) {
+      if (c.value.contract == system_account) {
          _token.authorization = {{ system_account, "token"_n }};
       }
-      _token.transfer(null_account, std::get<name>(it.recipient), it.value, processed_msg);
+      _token.transfer(null_account, std::get<name>(c.recipient), c.value, processed_msg);
    } else {
-      _token.transfer(_self, null_account, it.value, processed_msg);
+      _token.transfer(_self, null_account, c.value, processed_msg);
+   }
+}
+
+void htlc::withdraw(name owner, string contract_name, checksum256 preimage, eostd::binary_extension<uint64_t> id) {
+   auto settle = [&](auto& idx, const auto& it) {
+      check(it.timelock >= current_time_point(), "contract is expired");
+
+      // `preimage` works as a key here.
+      //require_auth(it.recipient);
+
+      auto data = preimage.extract_as_byte_array();
+      auto hash = eosio::sha256(reinterpret_cast<const char*>(data.data()), data.size());
+      check(memcmp((const void*)it.hashlock.data(), (const void*)hash.data(), 32) == 0, "invalid preimage");
+
+      release(owner, it);
+
+      unqueue(owner, it.primary_key());
+      idx.erase(it);
+   };
+
+   if (id) {
+      htlcid_index ids(_self, owner.value);
+      settle(ids, ids.get(*id));
+   } else {
+      htlc_index idx(_self, owner.value);
+      settle(idx, idx.get(lock_contract::key_of(contract_name, std::nullopt)));
+   }
+}
+
+void htlc::withdrawall(checksum256 preimage, uint32_t max_items) {
+   check(max_items > 0, "max_items should be positive");
+
+   auto data = preimage.extract_as_byte_array();
+   auto hash = eosio::sha256(reinterpret_cast<const char*>(data.data()), data.size());
+
+   expiry_index expiries(_self, _self.value);
+   auto hashlock = expiries.get_index<"hashlock"_n>();
+
+   // every contract is released by its own transfer, so that its memo names the contract.
+   // Expired contracts are left for refund, but count toward `max_items` so that they can't make a call unbounded.
+   uint32_t visited = 0, settled = 0;
+   for (auto it = hashlock.lower_bound(hash); it != hashlock.end() && it->hashlock == hash && visited < max_items; ++visited) {
+      if (it->timelock < current_time_point()) {
+         ++it;
+         continue;
+      }
+
+      visit(it->owner, it->id, [&](auto& idx, const auto& c) {
+         release(it->owner, c);
+         idx.erase(c);
+      });
+      it = hashlock.erase(it);
+      ++settled;
    }
 
-   idx.erase(it);
+   check(settled > 0, "no contract to withdraw");
 }
 
-void htlc::refund(name owner, string contract_name) {
+void htlc::refund(name owner, string contract_name, eostd::binary_extension<uint64_t> id) {
    //require_auth(owner);
 
-   htlc_index idx(_self, owner.value);
-   const auto& it = idx.get(std::hash<std::string>()(contract_name));
+   auto refund = [&](auto& idx, const auto& it) {
+      check(it.timelock < current_time_point(), "contract not expired");
 
-   check(it.timelock < current_time_point(), "contract not expired");
+      token _token;
+      if (std::holds_alternative<name>(it.recipient)) {
+         check(owner == vault_account, "must not happen");
+      } else {
+         auto bytes = std::get<checksum160>(it.recipient).extract_as_byte_array();
+         auto memo = (memo_buffer() << "htlc refunded from").hex(bytes.data(), bytes.size()).label(it).str();
+         _token.transfer(_self, owner, it.value, memo);
+      }
 
-   token _token;
-   if (std::holds_alternative<name>(it.recipient)) {
-      check(owner == vault_account, "must not happen");
+      unqueue(owner, it.primary_key());
+      idx.erase(it);
+   };
+
+   if (id) {
+      htlcid_index ids(_self, owner.value);
+      refund(ids, ids.get(*id));
    } else {
-      auto bytes = std::get<checksum160>(it.recipient).extract_as_byte_array();
-      auto str_recipient = eostd::to_hex(reinterpret_cast<const char*>(bytes.data()), bytes.size());
-      _token.transfer(_self, owner, it.value, "htlc refunded from" + str_recipient + (contract_name.size() ? ": " : "") + contract_name);
+      htlc_index idx(_self, owner.value);
+      refund(idx, idx.get(lock_contract::key_of(contract_name, std::nullopt)));
    }
+}
+
+void htlc::refundexpired(uint32_t max_items) {
+   check(max_items > 0, "max_items should be positive");
+
+   expiry_index expiries(_self, _self.value);
+   auto timelock = expiries.get_index<"timelock"_n>();
+
+   // `it` moves only by erase, so a call consumes expired entries from the earliest timelock
+   // and leaves whatever is beyond `max_items` at the head for the next call
+   totals rf;
+   uint32_t refunded = 0;
+   for (auto it = timelock.begin(); it != timelock.end() && refunded < max_items; ++refunded) {
+      if (it->timelock >= current_time_point()) break;
+
+      visit(it->owner, it->id, [&](auto& idx, const auto& c) {
+         // value locked by vault is not transferred in, so there is nothing to return
+         if (std::holds_alternative<checksum160>(c.recipient)) {
+            auto r = rf.emplace(std::make_pair(it->owner, c.value.get_extended_symbol()), asset{0, c.value.quantity.symbol}).first;
+            r->second += c.value.quantity;
+         }
+         idx.erase(c);
+      });
+      it = timelock.erase(it);
+   }
+
+   check(refunded > 0, "no expired contract");
+
+   token _token;
+   for (const auto& r: rf) {
+      _token.transfer(_self, r.first.first, extended_asset{r.second, r.first.second.get_contract()}, "htlc refunded");
+   }
+}
 
-   idx.erase(it);
+void htlc::unqueue(name owner, uint64_t id) {
+   // contracts created before the queue have no entry
+   expiry_index expiries(_self, _self.value);
+   auto contract = expiries.get_index<"contract"_n>();
+   auto it = contract.find(expiry::contract_key(owner, id));
+   if (it != contract.end() && it->owner == owner && it->id == id) contract.erase(it);
 }
 
 void htlc::setconfig(extended_asset min_amount, uint32_t min_duration, std::optional<uint16_t> rate, std::optional<asset> fixed) {
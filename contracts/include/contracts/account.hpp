@@ -48,6 +48,17 @@ public:
    [[eosio::action]]
    void setnick(name name, string nickname);
 
+   struct nick_item {
+      name account;
+      string nickname;
+
+      EOSLIB_SERIALIZE(nick_item, (account)(nickname))
+   };
+
+   // sets nicknames of accounts created at once by system contract
+   [[eosio::action]]
+   void setnicks(std::vector<nick_item> items);
+
    [[eosio::action]]
    void setpartner(name name, bool is_partner);
 
@@ -68,6 +79,8 @@ public:
    }
 
 private:
+   void set_nickname(accounts_index& acc, name name, const string& nickname);
+
    constexpr static bool is_valid_char(uint32_t cp) {
       if( (cp >= 'A') && (cp <= 'Z') ) return true;
       if( (cp >= 'a') && (cp <= 'z') ) return true;
@@ -3,7 +3,11 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/singleton.hpp>
+#include <eosio/system.hpp>
+#include <eostd/binary_extension.hpp>
+#include <contracts/bancor_math.hpp>
 #include <cmath>
+#include <map>
 
 using namespace eosio;
 using std::string;
@@ -18,53 +22,44 @@ public:
       extended_symbol smart; // 16
       asset balance;         // 32
       double weight = .5;    // 40
+      eostd::binary_extension<double> price_cumulative;     // 48
+      eostd::binary_extension<time_point_sec> last_updated; // 52
+      eostd::binary_extension<asset> supply;                // 68
+
+      // mirror of smart token supply, read from token contract if not set yet
+      asset get_supply() const;
+      void add_supply(int64_t amount) {
+         auto s = get_supply();
+         s.amount += amount;
+         supply.emplace(s);
+      }
 
-      struct converted {
-         extended_asset value;
-         asset delta;
-         double ratio;
-      };
+      bancor_math::pool get_pool(double reserve_rate) const {
+         return { double(get_supply().amount), double(balance.amount), weight,
+                  smart.get_symbol().precision(), balance.symbol.precision(), reserve_rate };
+      }
 
-      converted convert_to_smart(const extended_asset& from, const extended_symbol& to, bool reverse = false);
-      converted convert_from_smart(const extended_asset& from, const extended_symbol& to, bool reverse = false);
+      void apply(const bancor_math::quote& q);
 
-      converted convert_to_exact_smart(const extended_symbol& from, const extended_asset& to) {
-         return convert_from_smart(to, from, true);
-      }
-      converted convert_exact_from_smart(const extended_symbol& from, const extended_asset& to) {
-         return convert_to_smart(to, from, true);
+      // price of one smart token in connected token
+      double get_price(double current_supply) const {
+         return balance.amount / (current_supply * weight) * std::pow(10, smart.get_symbol().precision() - balance.symbol.precision());
       }
 
+      // `price_cumulative` accumulates price * seconds until `last_updated`, so TWAP over any period is
+      // the difference of `price_cumulative` divided by the difference of `last_updated` between two reads.
+      void update_price_cumulative(double current_supply);
+
       uint64_t primary_key() const { return smart.get_symbol().code().raw(); }
 
-      EOSLIB_SERIALIZE(connector, (smart)(balance)(weight))
+      EOSLIB_SERIALIZE(connector, (smart)(balance)(weight)(price_cumulative)(last_updated)(supply))
    };
 
    struct base_config {
       uint16_t rate; // permyriad
       asset connected; // if amount != 0, it's considered as fixed amount of conversion fee
 
-      bool is_exempted()const { return connected.amount == 0 && rate == 0; }
-
-      extended_asset get_fee(extended_asset value)const {
-         int64_t fee = 0;
-         if (rate != 0) {
-            int64_t p = 10000 / rate;
-            fee = (value.quantity.amount + p - 1) / p;
-         }
-         fee += connected.amount;
-         return {fee, value.get_extended_symbol()};
-      }
-
-      extended_asset get_required_fee(extended_asset value)const {
-         int64_t fee = 0;
-         if (rate != 0) {
-            int64_t p = 10000 / rate;
-            fee = int64_t((value.quantity.amount + connected.amount) * p / double(p - 1) + 0.9) - value.quantity.amount;
-         }
-         fee += connected.amount;
-         return {fee, value.get_extended_symbol()};
-      }
+      bancor_math::charge get_charge()const { return { rate, connected.amount }; }
 
       EOSLIB_SERIALIZE(base_config, (rate)(connected))
    };
@@ -94,6 +89,13 @@ public:
    [[eosio::action]]
    void convert(name sender, extended_asset from, extended_asset to);
 
+   [[eosio::action]]
+   void convertmany(name sender, std::vector<std::pair<extended_asset, extended_asset>> conversions);
+
+   // resets supply mirror of connector to the supply of token, anyone can call
+   [[eosio::action]]
+   void reconcile(extended_symbol smart);
+
    [[eosio::action]]
    void init(name admin, extended_symbol connected);
 
@@ -107,7 +109,21 @@ public:
    void setadmin(name admin);
 
 private:
-   extended_asset get_fee(const extended_asset& value, const extended_asset& smart, const config& c, bool required = false);
+   struct settlement {
+      struct flow {
+         int64_t issued = 0;  // issued to sender (retired from sender if negative)
+         int64_t claimed = 0; // claimed from reserve on behalf of sender
+      };
+
+      int64_t connected = 0;                   // pulled from sender (paid to sender if negative)
+      int64_t fee = 0;                         // forwarded to admin
+      std::map<extended_symbol, flow> smart;   // netted per smart token
+   };
+
+   void convert_one(const extended_asset& from, const extended_asset& to, const config& c, settlement& st);
+   void settle(name sender, const config& c, const settlement& st);
+
+   bancor_math::charge get_charge(const extended_symbol& smart, const config& c);
 };
 
 } /// namespace gxc
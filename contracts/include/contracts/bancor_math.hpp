@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Conversion math of bancor contract on plain numbers. Every amount is a raw amount of asset.
+ *
+ * `bancor_quote` quotes conversions off-chain with these functions, and its quotes are
+ * expected to be what `convert` does to the last raw unit, so keep eosio types out of here.
+ */
+namespace gxc { namespace bancor_math {
+
+struct charge {
+   uint16_t rate = 0;  // permyriad
+   int64_t  fixed = 0; // if not 0, it's considered as fixed amount of conversion fee
+
+   bool is_exempted() const { return fixed == 0 && rate == 0; }
+
+   // `required` computes the fee to be added to `value`, instead of the fee taken out of it
+   int64_t get_fee(int64_t value, bool required = false) const {
+      if (is_exempted()) return 0;
+
+      int64_t fee = 0;
+      if (rate != 0) {
+         int64_t p = 10000 / rate;
+         if (!required) fee = (value + p - 1) / p;
+         else fee = int64_t((value + fixed) * p / double(p - 1) + 0.9) - value;
+      }
+      fee += fixed;
+      return (fee > 0) ? fee : 1;
+   }
+};
+
+struct pool {
+   double  supply;              // supply of smart token
+   double  balance;             // connector balance in connected token
+   double  weight;
+   uint8_t smart_precision;
+   uint8_t connected_precision;
+   double  reserve_rate = 0;    // 0 if smart token has no reserve
+};
+
+struct converted {
+   int64_t value;
+   int64_t delta;
+   double  ratio;
+};
+
+// paying `amount` of connected token
+inline converted to_smart(double S, double C, double weight, int64_t amount) {
+   double dS = S * (std::pow(1. + amount / C, weight) - 1.);
+   if (dS < 0) dS = 0;
+
+   auto conversion_rate = ((int64_t)dS) / dS;
+   return { int64_t(dS), amount - int64_t(amount * (1 - conversion_rate)), conversion_rate };
+}
+
+// paying `amount` of smart token
+inline converted from_smart(double S, double C, double weight, int64_t amount) {
+   const double dS = -amount;
+
+   double dC = C * (std::pow(1. + dS / S, double(1) / weight) - 1.);
+   if (dC > 0) dC = 0;
+
+   return { int64_t(-dC), int64_t(-dC), ((int64_t)-dC) / (-dC) };
+}
+
+struct quote {
+   int64_t connected = 0;    // paid by sender (paid to sender if negative)
+   int64_t smart = 0;        // issued to sender (retired from sender if negative)
+   int64_t fee = 0;
+   int64_t balance = 0;      // change of connector balance
+   bool    claimed = false;  // retired smart token is claimed from reserve instead
+   const char* error = nullptr;
+};
+
+// buy smart token with exact `amount` of connected token
+inline quote buy(const pool& p, const charge& c, int64_t amount) {
+   quote q;
+
+   auto fee = c.get_fee(amount);
+   auto quant_after_fee = amount - fee;
+   if (quant_after_fee <= 0) return q.error = "paid token not enough after charging fee", q;
+
+   auto smart_issued = to_smart(p.supply, p.balance, p.weight, quant_after_fee);
+   if (smart_issued.value <= 0) return q.error = "paid token not enough for conversion", q;
+
+   if (p.reserve_rate != 0) {
+      double unit_price = smart_issued.delta * std::pow(10, p.smart_precision)
+                        / double(smart_issued.value) / std::pow(10, p.connected_precision);
+      if (p.reserve_rate > unit_price) {
+         double dS = quant_after_fee / p.reserve_rate / std::pow(10, p.connected_precision - p.smart_precision);
+         if (dS < 0) dS = 0;
+
+         auto conversion_rate = ((int64_t)dS) / dS;
+         smart_issued.value = int64_t(dS);
+         smart_issued.delta = quant_after_fee - int64_t(quant_after_fee * (1 - conversion_rate));
+         smart_issued.ratio = conversion_rate;
+      }
+   }
+
+   if (quant_after_fee - smart_issued.delta > 0) {
+      auto overcharged = int64_t(fee * (1 - smart_issued.ratio));
+      if (overcharged < 0) overcharged = 0;
+      fee -= overcharged;
+   }
+
+   q.connected = smart_issued.delta + fee;
+   q.smart = smart_issued.value;
+   q.fee = fee;
+   q.balance = smart_issued.delta;
+   return q;
+}
+
+// buy exact `amount` of smart token
+inline quote buy_exact(const pool& p, const charge& c, int64_t amount) {
+   quote q;
+
+   auto connected_required = from_smart(p.supply, p.balance, p.weight, amount);
+
+   if (p.reserve_rate != 0) {
+      double unit_price = connected_required.delta * std::pow(10, p.smart_precision)
+                        / double(amount) / std::pow(10, p.connected_precision);
+      if (p.reserve_rate > unit_price) {
+         double dC = amount * p.reserve_rate / std::pow(10, p.smart_precision - p.connected_precision);
+         if (dC < 0) dC = 0;
+
+         auto conversion_rate = ((int64_t)dC) / dC;
+         connected_required.value = int64_t(dC);
+         connected_required.delta = int64_t(dC);
+         connected_required.ratio = conversion_rate;
+      }
+   }
+
+   auto fee = c.get_fee(connected_required.delta, true);
+
+   q.connected = connected_required.delta + fee;
+   q.smart = amount;
+   q.fee = fee;
+   q.balance = connected_required.delta;
+   return q;
+}
+
+// sell exact `amount` of smart token
+inline quote sell(const pool& p, const charge& c, int64_t amount) {
+   quote q;
+
+   // pricing runs out of curve at the supply, which may lag behind the token if it isn't reconciled
+   if (amount >= p.supply) return q.error = "not enough supply to sell", q;
+
+   auto connected_out = from_smart(p.supply, p.balance, p.weight, amount);
+
+   if (p.reserve_rate != 0) {
+      double unit_price = connected_out.delta * std::pow(10, p.smart_precision)
+                        / double(amount) / std::pow(10, p.connected_precision);
+      if (p.reserve_rate > unit_price) {
+         double dC = amount * p.reserve_rate / std::pow(10, p.smart_precision - p.connected_precision);
+         if (dC < 0) dC = 0;
+
+         auto conversion_rate = ((int64_t)dC) / dC;
+         connected_out.value = int64_t(dC);
+         connected_out.delta = int64_t(dC);
+         connected_out.ratio = conversion_rate;
+
+         q.claimed = true;
+      }
+   }
+
+   auto fee = c.get_fee(connected_out.value);
+
+   auto quant_after_fee = connected_out.value - fee;
+   if (quant_after_fee <= 0) return q.error = "paid token not enough after charging fee", q;
+
+   auto refund = int64_t(amount * (1 - connected_out.ratio));
+
+   q.connected = -quant_after_fee;
+   q.smart = -(amount - refund);
+   q.fee = fee;
+   q.balance = (!q.claimed) ? -connected_out.delta : 0;
+   if (-q.balance >= p.balance) q.error = "not enough connector balance";
+   return q;
+}
+
+// sell smart token for exact `amount` of connected token
+inline quote sell_exact(const pool& p, const charge& c, int64_t amount) {
+   quote q;
+
+   auto fee = c.get_fee(amount, true);
+   auto smart_required = to_smart(p.supply, p.balance, p.weight, amount + fee);
+
+   if (p.reserve_rate != 0) {
+      double unit_price = smart_required.delta * std::pow(10, p.smart_precision)
+                        / double(smart_required.value) / std::pow(10, p.connected_precision);
+      if (p.reserve_rate > unit_price) {
+         double dS = amount / p.reserve_rate / std::pow(10, p.connected_precision - p.smart_precision);
+         if (dS < 0) dS = 0;
+
+         auto conversion_rate = ((int64_t)dS) / dS;
+         smart_required.value = int64_t(dS);
+         smart_required.delta = amount - int64_t(amount * (1 - conversion_rate));
+         smart_required.ratio = conversion_rate;
+
+         q.claimed = true;
+      }
+   }
+
+   if (smart_required.value >= p.supply) return q.error = "not enough supply to sell", q;
+
+   q.connected = -(smart_required.delta - fee);
+   q.smart = -smart_required.value;
+   q.fee = fee;
+   q.balance = (!q.claimed) ? -smart_required.delta : 0;
+   if (-q.balance >= p.balance) q.error = "not enough connector balance";
+   return q;
+}
+
+} } /// namespace gxc::bancor_math
@@ -4,21 +4,32 @@
 #include <eosio/asset.hpp>
 #include <eosio/crypto.hpp>
 
+#include <eostd/crypto/drbg.hpp>
 #include <eostd/crypto/xxhash.hpp>
+#include <eostd/binary_extension.hpp>
 #include <eostd/bytes.hpp>
+#include <eostd/symbol.hpp>
+#include <misc/hash.hpp>
 #include <misc/name.hpp>
 #include <misc/action.hpp>
+#include <contracts/gacha_math.hpp>
+
+#include <map>
+#include <variant>
 
 namespace gxc {
 
 using namespace eosio;
 using namespace std;
 using bytes = eostd::bytes;
+using eostd::extended_symbol_code;
 
 class [[eosio::contract]] gacha : public contract {
 public:
    using contract::contract;
 
+   static constexpr uint16_t max_pulls = 100;
+
    struct grade {
       asset               reward;
       uint32_t            score;
@@ -27,7 +38,8 @@ public:
       EOSLIB_SERIALIZE(grade, (reward)(score)(limit))
    };
 
-   struct [[eosio::table]] scheme {
+   // scheme before configuration and counters were split, kept until moved by migrate
+   struct [[eosio::table("scheme")]] legacy_scheme {
       name              scheme_name;
       vector<grade>     grades;
       extended_asset    budget;
@@ -41,12 +53,152 @@ public:
 
       uint64_t primary_key()const { return scheme_name.value; }
 
-      EOSLIB_SERIALIZE(scheme, (scheme_name)(grades)(budget)(expiration)(precision)(deadline_sec)(out)(out_count)(issued)(unresolved))
+      EOSLIB_SERIALIZE(legacy_scheme, (scheme_name)(grades)(budget)(expiration)(precision)(deadline_sec)(out)(out_count)(issued)(unresolved))
    };
 
-   typedef multi_index<"scheme"_n, scheme> scheme_index;
+   typedef multi_index<"scheme"_n, legacy_scheme> legacy_scheme_index;
+
+   // configuration of scheme, written once when opened
+   struct [[eosio::table("schemecfg")]] scheme {
+      name              scheme_name;
+      extended_asset    budget;
+      time_point_sec    expiration;
+      uint8_t           precision;
+      uint32_t          deadline_sec;
+      bool              instant = false; // drawn in issue without commit and reveal
 
-   struct [[eosio::table("gacha")]] _gacha {
+      uint64_t primary_key()const { return scheme_name.value; }
+
+      EOSLIB_SERIALIZE(scheme, (scheme_name)(budget)(expiration)(precision)(deadline_sec)(instant))
+   };
+
+   typedef multi_index<"schemecfg"_n, scheme> scheme_index;
+
+   // counters of scheme, updated by every issue and draw
+   struct [[eosio::table]] schemestat {
+      name              scheme_name;
+      asset             out;
+      uint32_t          issued = 0;     // number of pulls
+      uint32_t          unresolved = 0; // number of opened gacha
+
+      uint64_t primary_key()const { return scheme_name.value; }
+
+      EOSLIB_SERIALIZE(schemestat, (scheme_name)(out)(issued)(unresolved))
+   };
+
+   typedef multi_index<"schemestat"_n, schemestat> schemestat_index;
+
+   // grades of every scheme of contract, scoped by scheme contract
+   //
+   // "scheme" index orders grades by scheme and then by descending score. Within a scheme,
+   // the first grade at or after lower_bound(scheme_key(scheme_name, key_of(score))) is the grade with the highest score
+   // not above the drawn score, and the following rows are the fallbacks when its limit is reached.
+   struct [[eosio::table("grade")]] _grade {
+      uint64_t            id;
+      name                scheme_name;
+      uint64_t            key;
+      uint32_t            index;
+      asset               reward;
+      optional<uint32_t>  limit;
+      uint32_t            out_count = 0;
+
+      static uint64_t key_of(uint32_t score) { return gacha_math::key_of(score); }
+      static uint128_t scheme_key(name scheme_name, uint64_t key) { return (uint128_t)scheme_name.value << 64 | key; }
+
+      uint32_t score() const { return gacha_math::score_of(key); }
+      bool is_exhausted(uint32_t drawn = 0) const { return limit && out_count + drawn >= *limit; }
+
+      uint64_t primary_key() const { return id; }
+      uint128_t by_scheme() const { return scheme_key(scheme_name, key); }
+
+      EOSLIB_SERIALIZE(_grade, (id)(scheme_name)(key)(index)(reward)(limit)(out_count))
+   };
+
+   typedef multi_index<"grade"_n, _grade,
+              indexed_by<"scheme"_n, const_mem_fun<_grade, uint128_t, &_grade::by_scheme>>
+           > grade_index;
+
+   // merkle root committing dseedhash of gacha issued together, scoped by scheme contract
+   struct [[eosio::table]] batch {
+      uint64_t        id;
+      checksum256     root;
+      uint32_t        size;
+      uint32_t        remaining; // number of gacha not drawn yet
+
+      // number of siblings in proof of every leaf
+      uint8_t depth() const {
+         uint8_t d = 0;
+         while ((uint64_t(1) << d) < size) ++d;
+         return d;
+      }
+
+      uint64_t primary_key() const { return id; }
+
+      EOSLIB_SERIALIZE(batch, (id)(root)(size)(remaining))
+   };
+
+   typedef multi_index<"batch"_n, batch> batch_index;
+
+   struct leaf {
+      uint64_t        batch;
+      uint32_t        index;
+
+      EOSLIB_SERIALIZE(leaf, (batch)(index))
+   };
+
+   struct ticket {
+      name                to;
+      optional<uint64_t>  id;
+      optional<uint16_t>  pulls;
+
+      EOSLIB_SERIALIZE(ticket, (to)(id)(pulls))
+   };
+
+   // seeds revealed together in issue of instant scheme
+   struct seeds {
+      checksum256          dseed;
+      checksum256          oseed;
+
+      EOSLIB_SERIALIZE(seeds, (dseed)(oseed))
+   };
+
+   // outcome of a pull, without reward for raincheck
+   struct pull_result {
+      uint64_t                  id;
+      int64_t                   score;
+      optional<extended_asset>  reward;
+
+      EOSLIB_SERIALIZE(pull_result, (id)(score)(reward))
+   };
+
+   struct reveal_item {
+      uint64_t             id;
+      checksum256          dseed;
+      vector<checksum256>  proof;
+
+      EOSLIB_SERIALIZE(reveal_item, (id)(dseed)(proof))
+   };
+
+   // issued gacha waiting for oseed of owner, scoped by scheme contract
+   struct [[eosio::table]] pending {
+      uint64_t        id;
+      name            owner;
+      extended_name   scheme;
+      std::variant<checksum256, leaf> dseedhash; // hash of dseed, or leaf of batch committing it
+      uint16_t        pulls = 1;
+
+      uint64_t primary_key() const { return id; }
+      uint64_t by_owner() const { return owner.value; }
+
+      EOSLIB_SERIALIZE(pending, (id)(owner)(scheme)(dseedhash)(pulls))
+   };
+
+   typedef multi_index<"pending"_n, pending,
+              indexed_by<"owner"_n, const_mem_fun<pending, uint64_t, &pending::by_owner>>
+           > pending_index;
+
+   // gacha before pending and opened were split, scoped by gacha contract and kept until moved by migrategacha
+   struct [[eosio::table("gacha")]] legacy_gacha {
       uint64_t        id;
       name            owner;
       extended_name   scheme;
@@ -54,6 +206,28 @@ public:
       checksum256     oseed = {};
       time_point_sec  deadline = time_point_sec::maximum();
 
+      uint64_t primary_key() const { return id; }
+      uint64_t by_owner() const { return owner.value; }
+      uint64_t by_deadline() const { return static_cast<uint64_t>(deadline.utc_seconds); }
+
+      EOSLIB_SERIALIZE(legacy_gacha, (id)(owner)(scheme)(dseedhash)(oseed)(deadline))
+   };
+
+   typedef multi_index<"gacha"_n, legacy_gacha,
+              indexed_by<"owner"_n, const_mem_fun<legacy_gacha, uint64_t, &legacy_gacha::by_owner>>,
+              indexed_by<"deadline"_n, const_mem_fun<legacy_gacha, uint64_t, &legacy_gacha::by_deadline>>
+           > legacy_gacha_index;
+
+   // opened gacha, moved from pending by setoseed and drawn by dealer or after deadline, scoped by scheme contract
+   struct [[eosio::table("opened")]] _gacha {
+      uint64_t        id;
+      name            owner;
+      extended_name   scheme;
+      std::variant<checksum256, leaf> dseedhash;
+      checksum256     oseed;
+      time_point_sec  deadline;
+      uint16_t        pulls = 1;
+
       static uint64_t hash(extended_name scheme, const checksum256& dseedhash) {
          std::array<char,2*8+32> data;
          datastream<char*> ds(data.data(), data.size());
@@ -62,45 +236,126 @@ public:
          return eostd::xxh64(data.data(), data.size());
       }
 
+      static uint64_t hash(extended_name scheme, const checksum256& root, uint32_t index) {
+         std::array<char,2*8+32+4> data;
+         datastream<char*> ds(data.data(), data.size());
+         ds << scheme;
+         ds << root.extract_as_byte_array();
+         ds << index;
+         return eostd::xxh64(data.data(), data.size());
+      }
+
       uint64_t primary_key() const { return id; }
       uint64_t by_owner() const { return owner.value; }
-      uint64_t by_deadline() const { return static_cast<uint64_t>(deadline.utc_seconds); }
 
-      EOSLIB_SERIALIZE(_gacha, (id)(owner)(scheme)(dseedhash)(oseed)(deadline))
+      EOSLIB_SERIALIZE(_gacha, (id)(owner)(scheme)(dseedhash)(oseed)(deadline)(pulls))
    };
 
-   typedef multi_index<"gacha"_n, _gacha,
-              indexed_by<"owner"_n, const_mem_fun<_gacha, uint64_t, &_gacha::by_owner>>,
-              indexed_by<"deadline"_n, const_mem_fun<_gacha, uint64_t, &_gacha::by_deadline>>
+   typedef multi_index<"opened"_n, _gacha,
+              indexed_by<"owner"_n, const_mem_fun<_gacha, uint64_t, &_gacha::by_owner>>
            > gacha_index;
 
+   // ids drawn by instant issue, scoped by scheme contract, so that an id is drawn once
+   struct [[eosio::table]] instant {
+      uint64_t        id;
+
+      uint64_t primary_key() const { return id; }
+
+      EOSLIB_SERIALIZE(instant, (id))
+   };
+
+   typedef multi_index<"instant"_n, instant> instant_index;
+
+   // deadlines of opened gacha in every scope, queued for resolve
+   struct [[eosio::table]] due {
+      uint64_t        key;
+      name            contract;
+      uint64_t        id;
+      time_point_sec  deadline;
+
+      static uint128_t gacha_key(name contract, uint64_t id) { return (uint128_t)contract.value << 64 | id; }
+
+      uint64_t primary_key() const { return key; }
+      uint64_t by_deadline() const { return static_cast<uint64_t>(deadline.utc_seconds); }
+      uint128_t by_gacha() const { return gacha_key(contract, id); }
+
+      EOSLIB_SERIALIZE(due, (key)(contract)(id)(deadline))
+   };
+
+   typedef multi_index<"due"_n, due,
+              indexed_by<"deadline"_n, const_mem_fun<due, uint64_t, &due::by_deadline>>,
+              indexed_by<"gacha"_n, const_mem_fun<due, uint128_t, &due::by_gacha>>
+           > due_index;
+
+   // rewards won but not claimed yet, scoped by owner, and reserved by owner when opening gacha
+   struct [[eosio::table]] reward {
+      extended_asset  balance;
+
+      uint64_t primary_key() const { return std::hash<extended_symbol_code>()(extended_symbol_code{balance.quantity.symbol.code(), balance.contract}); }
+
+      EOSLIB_SERIALIZE(reward, (balance))
+   };
+
+   typedef multi_index<"reward"_n, reward> reward_index;
+
    [[eosio::action]]
    void close(extended_name scheme);
 
+   // moves scheme of the former layout to configuration, counters and grades, anyone can call
+   [[eosio::action]]
+   void migrate(extended_name scheme);
+
+   // moves up to `max_items` gacha of the former layout to pending or opened, anyone can call
+   [[eosio::action]]
+   void migrategacha(uint32_t max_items);
+
    [[eosio::action]]
-   void open(extended_name scheme, std::vector<grade> &grades, extended_asset budget, time_point_sec expiration, optional<uint8_t> precision, optional<uint32_t> deadline_sec);
+   void open(extended_name scheme, std::vector<grade> &grades, extended_asset budget, time_point_sec expiration, optional<uint8_t> precision, optional<uint32_t> deadline_sec, optional<bool> instant);
 
    [[eosio::action]]
-   void issue(name to, extended_name scheme, checksum256 dseedhash, optional<uint64_t> id);
+   void issue(name to, extended_name scheme, checksum256 dseedhash, optional<uint64_t> id, optional<uint16_t> pulls, optional<seeds> instant);
 
    [[eosio::action]]
-   void setoseed(uint64_t id, checksum256 oseed);
+   void issuebatch(extended_name scheme, checksum256 root, std::vector<ticket>& tickets);
 
    [[eosio::action]]
-   void setdseed(uint64_t id, checksum256 dseed);
+   void setoseed(name contract, uint64_t id, checksum256 oseed);
 
    [[eosio::action]]
-   void winreward(name owner, uint64_t id, int64_t score, extended_asset value);
+   void setdseed(name contract, uint64_t id, checksum256 dseed);
 
    [[eosio::action]]
-   void raincheck(name owner, uint64_t id, int64_t score);
+   void reveal(name contract, std::vector<reveal_item>& items);
 
+   // outcomes of every pull of `owner` drawn in an action, notified once per owner
    [[eosio::action]]
-   void resolve();
+   void drawresult(name owner, std::vector<pull_result>& results);
+
+   // draws up to `max_items` expired gacha and credits rewards, anyone can call
+   [[eosio::action]]
+   void resolve(uint32_t max_items);
+
+   [[eosio::action]]
+   void claim(name owner);
+
+private:
+   // rewards and outcomes drawn in an action, aggregated by owner
+   struct payouts {
+      std::map<std::pair<name, extended_symbol>, int64_t> amounts; // by owner and token
+      std::map<name, std::vector<pull_result>> results;
+   };
+
+   void resolve_one(name contract, uint64_t id, payouts& po);
+   void draw(name contract, uint64_t id, optional<checksum256> dseed, const vector<checksum256>& proof, payouts& po);
+   // draws `pulls` rewards, and without drbg only of grades within `left` of budget, rainchecking pulls no grade can pay
+   asset roll(extended_name scheme, const extended_asset& left, uint8_t precision, name owner, uint64_t id, uint16_t pulls, eostd::hash_drbg* drbg, payouts& po);
+   // credits rewards and notifies outcomes by owner
+   void credit(const payouts& po);
+   // row of reward paid by owner, so that draw only modifies it
+   void reserve_reward(name owner, const extended_symbol& symbol);
 
-   void refresh_schedule();
-   void resolve_one(uint64_t id);
-   void draw(uint64_t id, optional<checksum256> dseed = nullopt);
+   uint16_t issue_one(pending_index& pnd, name to, extended_name scheme, uint64_t id, std::variant<checksum256, leaf> dseedhash, optional<uint16_t> pulls);
+   void check_dseed(const _gacha& g, const checksum256& dseed, const vector<checksum256>& proof);
 };
 
 }
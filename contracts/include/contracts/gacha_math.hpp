@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+/**
+ * How a pull turns into a grade: to_score() reads the score from drbg output, and select()
+ * walks grades keyed by key_of() from the drawn score down past exhausted ones.
+ *
+ * gacha-verify includes this header as it is to replay draws outside the chain.
+ */
+namespace gxc { namespace gacha_math {
+
+// bytes of drbg output consumed by a pull
+constexpr size_t bytes_per_pull = 4;
+
+// ids of recent blocks, from the last one back, mixed into the seed of instant draw
+constexpr uint32_t instant_blocks = 4;
+
+// score of a pull, the first `precision` bytes of drbg output read as little endian
+inline int64_t to_score(const uint8_t* result, uint8_t precision) {
+   int64_t score = 0;
+   memcpy((void*)&score, (const void*)result, precision);
+   return score;
+}
+
+// grades are keyed by the inverted score, so ascending keys are grades in descending score
+inline uint64_t key_of(uint32_t score) { return std::numeric_limits<uint32_t>::max() - score; }
+inline uint32_t score_of(uint64_t key) { return static_cast<uint32_t>(std::numeric_limits<uint32_t>::max() - key); }
+
+// From `lower_bound(key_of(score))`, the grade with the highest score not above the drawn score,
+// steps to lower grades while `is_exhausted` tells the grade reached its limit.
+// Returns `last` if every remaining grade is exhausted.
+template<typename Iterator, typename Exhausted>
+inline Iterator select(Iterator lower_bound, Iterator last, Exhausted&& is_exhausted) {
+   auto it = lower_bound;
+   while (it != last && is_exhausted(*it)) ++it;
+   return it;
+}
+
+} } /// namespace gxc::gacha_math
@@ -3,8 +3,11 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/crypto.hpp>
+#include <eostd/binary_extension.hpp>
 #include <misc/hash.hpp>
 
+#include <map>
+
 namespace gxc {
 
 using namespace eosio;
@@ -21,12 +24,55 @@ public:
       checksum256 hashlock;
       time_point_sec timelock;
 
+      // contracts created with id are kept in htlcid instead, and ids share the key space with contract names
+      static uint64_t key_of(const string& contract_name, const std::optional<uint64_t>& id) {
+         return (id) ? *id : std::hash<std::string>()(contract_name);
+      }
+
       uint64_t primary_key() const { return std::hash<std::string>()(contract_name); }
 
       EOSLIB_SERIALIZE(lock_contract, (contract_name)(recipient)(value)(hashlock)(timelock))
    };
    typedef multi_index<"htlc"_n, lock_contract> htlc_index;
 
+   // contract created with caller-supplied id, without contract name, scoped by owner
+   struct [[eosio::table("htlcid")]] id_contract {
+      uint64_t id;
+      std::variant<name, checksum160> recipient;
+      extended_asset value;
+      checksum256 hashlock;
+      time_point_sec timelock;
+
+      uint64_t primary_key() const { return id; }
+
+      EOSLIB_SERIALIZE(id_contract, (id)(recipient)(value)(hashlock)(timelock))
+   };
+   typedef multi_index<"htlcid"_n, id_contract> htlcid_index;
+
+   // timelocks of contracts in every scope, queued for refundexpired, and their hashlocks for withdrawall
+   struct [[eosio::table]] expiry {
+      uint64_t        key;
+      name            owner;
+      uint64_t        id;
+      time_point_sec  timelock;
+      checksum256     hashlock;
+
+      static uint128_t contract_key(name owner, uint64_t id) { return (uint128_t)owner.value << 64 | id; }
+
+      uint64_t primary_key() const { return key; }
+      uint64_t by_timelock() const { return static_cast<uint64_t>(timelock.utc_seconds); }
+      checksum256 by_hashlock() const { return hashlock; }
+      uint128_t by_contract() const { return contract_key(owner, id); }
+
+      EOSLIB_SERIALIZE(expiry, (key)(owner)(id)(timelock)(hashlock))
+   };
+
+   typedef multi_index<"expiry"_n, expiry,
+              indexed_by<"timelock"_n, const_mem_fun<expiry, uint64_t, &expiry::by_timelock>>,
+              indexed_by<"hashlock"_n, const_mem_fun<expiry, checksum256, &expiry::by_hashlock>>,
+              indexed_by<"contract"_n, const_mem_fun<expiry, uint128_t, &expiry::by_contract>>
+           > expiry_index;
+
    struct [[eosio::table]] config {
       asset min_amount;
       uint32_t min_duration;
@@ -39,17 +85,63 @@ public:
    };
    typedef multi_index<"config"_n, config> config_index;
 
+   struct lock_item {
+      string contract_name;
+      std::variant<name, checksum160> recipient;
+      extended_asset value;
+      checksum256 hashlock;
+      time_point_sec timelock;
+      std::optional<uint64_t> id;
+
+      EOSLIB_SERIALIZE(lock_item, (contract_name)(recipient)(value)(hashlock)(timelock)(id))
+   };
+
+   // `id` identifies the contract instead of `contract_name`, which should be empty then
+   [[eosio::action]]
+   void newcontract(name owner, string contract_name, std::variant<name, checksum160> recipient, extended_asset value, checksum256 hashlock, time_point_sec timelock, eostd::binary_extension<uint64_t> id);
+
+   // creates contracts of `owner` at once, pulling locked value by a transfer per token
+   [[eosio::action]]
+   void newcontracts(name owner, std::vector<lock_item> items);
+
    [[eosio::action]]
-   void newcontract(name owner, string contract_name, std::variant<name, checksum160> recipient, extended_asset value, checksum256 hashlock, time_point_sec timelock);
+   void withdraw(name owner, string contract_name, checksum256 preimage, eostd::binary_extension<uint64_t> id);
 
+   // visits up to `max_items` contracts locked by hash of `preimage` in any scope, and settles unexpired ones
    [[eosio::action]]
-   void withdraw(name owner, string contract_name, checksum256 preimage);
+   void withdrawall(checksum256 preimage, uint32_t max_items);
 
    [[eosio::action]]
-   void refund(name owner, string contract_name);
+   void refund(name owner, string contract_name, eostd::binary_extension<uint64_t> id);
+
+   // refunds up to `max_items` expired contracts in order of timelock, anyone can call
+   [[eosio::action]]
+   void refundexpired(uint32_t max_items);
 
    [[eosio::action]]
    void setconfig(extended_asset min_amount, uint32_t min_duration, std::optional<uint16_t> rate, std::optional<asset> fixed);
+
+private:
+   struct constraint {
+      extended_asset min_amount;
+      uint32_t       min_duration;
+   };
+
+   constraint get_constraint(name owner, const extended_symbol& symbol);
+   void lock(htlc_index& idx, htlcid_index& ids, expiry_index& expiries, name owner, const lock_item& item, const constraint& c);
+
+   // calls `f` with the index and the contract of `key` queued for `owner`, created either with id or with contract name
+   template<typename F>
+   void visit(name owner, uint64_t key, F&& f);
+
+   // sends locked value of `c` to its recipient, or to null account for a recipient of other chain
+   template<typename Contract>
+   void release(name owner, const Contract& c);
+
+   // summed amount by account and token, checked for overflow by asset
+   using totals = std::map<std::pair<name, extended_symbol>, asset>;
+
+   void unqueue(name owner, uint64_t id);
 };
 
 }
@@ -3,6 +3,7 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/singleton.hpp>
+#include <eostd/binary_extension.hpp>
 #include <misc/chain_types.hpp>
 #include <misc/privileged.hpp>
 #include <misc/action.hpp>
@@ -21,7 +22,7 @@ struct [[eosio::table("global"), eosio::contract("system")]] gxc_global_state :
    int64_t  total_ram_stake = 0;
    uint16_t new_ram_per_block = 0;
    block_timestamp last_ram_increase;
-   block_timestamp last_block_num;
+   block_timestamp last_block_num; // replaced by `lastblock` singleton and no longer updated, kept for layout of the row
    uint8_t  revision = 0;
    uint8_t  ram_gift_kbytes = 8;
 
@@ -32,11 +33,24 @@ struct [[eosio::table("global"), eosio::contract("system")]] gxc_global_state :
    )
 };
 
-struct [[eosio::table("block"), eosio::contract("system")]] block_context {
-   checksum256 id;
-   block_header header;
+// updated by every onblock apart from global state, not to rewrite blockchain parameters
+struct [[eosio::table("lastblock"), eosio::contract("system")]] last_block {
+   block_timestamp last_block_num;
+   eostd::binary_extension<uint32_t> block_num; // missing in a row written before recentblocks
+
+   EOSLIB_SERIALIZE(last_block, (last_block_num)(block_num))
+};
+
+// id and timestamp of recent blocks, overwritten in place at slot `block_num % recent_blocks_size`
+struct [[eosio::table("recentblocks"), eosio::contract("system")]] recent_block {
+   uint64_t        slot;
+   uint32_t        block_num;
+   block_timestamp timestamp;
+   checksum256     id;
+
+   uint64_t primary_key() const { return slot; }
 
-   EOSLIB_SERIALIZE(block_context, (id)(header))
+   EOSLIB_SERIALIZE(recent_block, (slot)(block_num)(timestamp)(id))
 };
 
 class [[eosio::contract]] system : public contract {
@@ -50,7 +64,6 @@ public:
    static constexpr name active_permission {"active"_n};
    static constexpr symbol ramcore_symbol = symbol(symbol_code("RAMCORE"), 4);
    static constexpr symbol ram_symbol = symbol(symbol_code("RAM"), 0);
-   static int64_t ram_gift_bytes;
 
    static symbol get_core_symbol(name system_account = default_account) {
       rammarket rm(system_account, system_account.value);
@@ -58,6 +71,29 @@ public:
       return sym;
    }
 
+   static constexpr uint32_t recent_blocks_size = 256;
+   using last_block_singleton = eosio::singleton<"lastblock"_n, last_block>;
+   using recent_block_index = eosio::multi_index<"recentblocks"_n, recent_block>;
+
+   // block `age` blocks before the last one seen by onblock, if it's still kept
+   static std::optional<recent_block> get_recent_block(uint32_t age = 0, name system_account = default_account) {
+      last_block_singleton last(system_account, system_account.value);
+      if (!last.exists() || age >= recent_blocks_size) return {};
+
+      auto l = last.get();
+      if (!l.block_num || *l.block_num <= age) return {};
+      auto block_num = *l.block_num;
+      return find_recent_block(static_cast<uint16_t>(block_num - age), system_account);
+   }
+
+   // block by lower 16 bits of its number as tapos refers to, if it's still kept
+   static std::optional<recent_block> find_recent_block(uint16_t ref_block_num, name system_account = default_account) {
+      recent_block_index blocks(system_account, system_account.value);
+      auto it = blocks.find(ref_block_num % recent_blocks_size);
+      if (it == blocks.end() || static_cast<uint16_t>(it->block_num) != ref_block_num) return {};
+      return *it;
+   }
+
    system(name receiver, name first_receiver, datastream<const char*> ds);
    ~system();
 
@@ -74,8 +110,9 @@ public:
    [[eosio::action]]
    void init(unsigned_int version, symbol core);
 
+   // header is hashed as received, so it's not deserialized by dispatcher
    [[eosio::action]]
-   void onblock(block_header header);
+   void onblock(ignore<block_header> header);
 
    [[eosio::action]]
    void setprods(std::vector<eosio::producer_key> schedule);
@@ -90,6 +127,10 @@ public:
    [[eosio::action]]
    void setalimits(name account, int64_t ram_bytes, int64_t net_weight, int64_t cpu_weight);
 
+   // sets limits of (account, ram_bytes, net_weight, cpu_weight) in order
+   [[eosio::action]]
+   void setalimitsv(std::vector<std::tuple<name, int64_t, int64_t, int64_t>> limits);
+
    [[eosio::action]]
    void buyram(name payer, name receiver, asset quant);
 
@@ -120,6 +161,19 @@ public:
    [[eosio::action]]
    void genaccount(name creator, name name, authority owner, authority active, std::string nickname);
 
+   struct account_item {
+      name account;
+      authority owner;
+      authority active;
+      std::string nickname;
+
+      EOSLIB_SERIALIZE(account_item, (account)(owner)(active)(nickname))
+   };
+
+   // creates accounts of `creator` at once, nicknames are set by a single inline action
+   [[eosio::action]]
+   void genaccounts(name creator, std::vector<account_item> accounts);
+
    // native action handlers
    [[eosio::action]]
    void newaccount(name creator, name name, ignore<authority> owner, ignore<authority> active);
@@ -151,10 +205,18 @@ public:
 
 private:
    using global_state_singleton = eosio::singleton<"global"_n, gxc_global_state>;
-   using block_index = eosio::singleton<"block"_n, block_context>;
-   rammarket               _rammarket;
-   global_state_singleton  _global;
-   gxc_global_state        _gstate;
+   rammarket                       _rammarket;
+   global_state_singleton          _global;
+   std::optional<gxc_global_state> _gstate;
+   bool                            _gstate_dirty = false;
+
+   // global state is read on first use, and written back only if it's modified
+   const gxc_global_state& gstate();
+   gxc_global_state& mutable_gstate();
+
+   int64_t ram_gift_bytes() { return gstate().ram_gift_kbytes * 1024; }
+
+   void set_account_limits(name account, int64_t ram, int64_t net, int64_t cpu, int64_t ram_gift);
 
    static symbol get_core_symbol(const rammarket& rm) {
       auto itr = rm.find(ramcore_symbol.raw());
@@ -119,8 +119,9 @@ void system::buyram( name payer, name receiver, asset quant ) {
 
    check( bytes_out > 0, "must reserve a positive amount" );
 
-   _gstate.total_ram_bytes_reserved += uint64_t(bytes_out);
-   _gstate.total_ram_stake          += quant_after_fee.amount;
+   auto& gs = mutable_gstate();
+   gs.total_ram_bytes_reserved += uint64_t(bytes_out);
+   gs.total_ram_stake          += quant_after_fee.amount;
 
    user_resources_table  userres( get_self(), receiver.value );
    auto res_itr = userres.find( receiver.value );
@@ -136,7 +137,7 @@ void system::buyram( name payer, name receiver, asset quant ) {
             res.ram_bytes += bytes_out;
          });
    }
-   eosio::set_resource_limits( res_itr->owner, res_itr->ram_bytes + ram_gift_bytes, res_itr->net_weight.amount, res_itr->cpu_weight.amount );
+   eosio::set_resource_limits( res_itr->owner, res_itr->ram_bytes + ram_gift_bytes(), res_itr->net_weight.amount, res_itr->cpu_weight.amount );
 }
 
 /**
@@ -155,8 +156,8 @@ void system::sellram( name account, int64_t bytes ) {
 
    user_resources_table  userres( get_self(), account.value );
    auto res_itr = userres.find( account.value );
-   check( res_itr != userres.end(), "no resource row" );
-   check( res_itr->ram_bytes >= bytes, "insufficient quota" );
+   // no resource row means zero quota
+   check( res_itr != userres.end() && res_itr->ram_bytes >= bytes, "insufficient quota" );
 
    asset tokens_out;
    auto itr = _rammarket.find(ramcore_symbol.raw());
@@ -167,16 +168,17 @@ void system::sellram( name account, int64_t bytes ) {
 
    check( tokens_out.amount > 1, "token amount received from selling ram is too low" );
 
-   _gstate.total_ram_bytes_reserved -= static_cast<decltype(_gstate.total_ram_bytes_reserved)>(bytes); // bytes > 0 is asserted above
-   _gstate.total_ram_stake          -= tokens_out.amount;
+   auto& gs = mutable_gstate();
+   gs.total_ram_bytes_reserved -= static_cast<decltype(gs.total_ram_bytes_reserved)>(bytes); // bytes > 0 is asserted above
+   gs.total_ram_stake          -= tokens_out.amount;
 
    //// this shouldn't happen, but just in case it does we should prevent it
-   check( _gstate.total_ram_stake >= 0, "error, attempt to unstake more tokens than previously staked" );
+   check( gs.total_ram_stake >= 0, "error, attempt to unstake more tokens than previously staked" );
 
    userres.modify( res_itr, account, [&]( auto& res ) {
        res.ram_bytes -= bytes;
    });
-   eosio::set_resource_limits( res_itr->owner, res_itr->ram_bytes + ram_gift_bytes, res_itr->net_weight.amount, res_itr->cpu_weight.amount );
+   eosio::set_resource_limits( res_itr->owner, res_itr->ram_bytes + ram_gift_bytes(), res_itr->net_weight.amount, res_itr->cpu_weight.amount );
 
    token _token;
 
@@ -250,7 +252,7 @@ void system::changebw( name from, name receiver,
       int64_t ram_bytes, net, cpu;
       eosio::get_resource_limits( receiver, ram_bytes, net, cpu );
 
-      eosio::set_resource_limits( receiver, std::max( tot_itr->ram_bytes + ram_gift_bytes, ram_bytes ), tot_itr->net_weight.amount, tot_itr->cpu_weight.amount );
+      eosio::set_resource_limits( receiver, std::max( tot_itr->ram_bytes + ram_gift_bytes(), ram_bytes ), tot_itr->net_weight.amount, tot_itr->cpu_weight.amount );
 
       if ( tot_itr->net_weight.amount == 0 && tot_itr->cpu_weight.amount == 0  && tot_itr->ram_bytes == 0 ) {
          totals_tbl.erase( tot_itr );
@@ -394,7 +396,7 @@ void system::refund( const name owner ) {
 
 void system::setramgift(uint8_t kbytes) {
    require_auth(_self);
-   _gstate.ram_gift_kbytes = kbytes;
+   mutable_gstate().ram_gift_kbytes = kbytes;
 }
 
 }
@@ -6,20 +6,58 @@
 
 namespace gxc {
 
-void system::onblock(block_header header) {
+void system::onblock(ignore<block_header> header) {
    require_auth(_self);
 
-   char raw[512];
-   datastream<char*> ds(raw, sizeof(raw));
-   ds << header;
-
-   block_context ctx;
-   ctx.id = eosio::sha256(raw, ds.tellp());
-   reinterpret_cast<uint32_t*>(ctx.id.data())[3] = tapos_block_num();
-   ctx.header = header;
-   block_index(_self, _self.value).set(ctx, _self);
+   // action data is the serialized header, hashed as is to get block id
+   constexpr size_t max_stack_buffer_size = 512;
+   auto size = action_data_size();
+   auto raw = static_cast<char*>((size > max_stack_buffer_size) ? malloc(size) : alloca(size));
+   read_action_data(raw, size);
+
+   // only the fields kept are decoded
+   block_timestamp timestamp;
+   capi_checksum256 previous;
+   datastream<const char*> ds(raw, size);
+   ds >> timestamp;
+   ds.skip(sizeof(name) + sizeof(uint16_t)); // producer, confirmed
+   ds >> previous;
+
+   // block id is hash of header with its block number in the first 4 bytes, big endian
+   auto block_num = (uint32_t(previous[0]) << 24 | uint32_t(previous[1]) << 16 |
+                     uint32_t(previous[2]) << 8 | uint32_t(previous[3])) + 1;
+   auto id = eosio::sha256(raw, size).extract_as_byte_array();
+   id[0] = uint8_t(block_num >> 24);
+   id[1] = uint8_t(block_num >> 16);
+   id[2] = uint8_t(block_num >> 8);
+   id[3] = uint8_t(block_num);
+
+   if (size > max_stack_buffer_size) free(raw);
+
+   recent_block_index blocks(_self, _self.value);
+   auto slot = block_num % recent_blocks_size;
+   auto update = [&](auto& b) {
+      b.slot = slot;
+      b.block_num = block_num;
+      b.timestamp = timestamp;
+      b.id = checksum256(id);
+   };
+
+   auto it = blocks.find(slot);
+   if (it == blocks.end()) {
+      blocks.emplace(_self, update);
+
+      // slots are first filled right after upgrade, when the block singleton replaced by this ring is dropped
+      auto old = eosio::internal_use_do_not_use::db_find_i64(_self.value, _self.value, "block"_n.value, "block"_n.value);
+      if (old >= 0) eosio::internal_use_do_not_use::db_remove_i64(old);
+   } else {
+      blocks.modify(it, same_payer, update);
+   }
 
-   _gstate.last_block_num = ctx.header.timestamp;
+   last_block last;
+   last.last_block_num = timestamp;
+   last.block_num.emplace(block_num);
+   last_block_singleton(_self, _self.value).set(last, _self);
 }
 
 void system::newaccount(name creator, name name, ignore<authority> owner, ignore<authority> active) {
@@ -33,15 +71,8 @@ void system::newaccount(name creator, name name, ignore<authority> owner, ignore
 
       check(!has_dot(name), "user account name cannot contain dot");
 
-      user_resources_table userres(_self, name.value);
-
-      userres.emplace(name, [&](auto& res) {
-         res.owner = name;
-         res.net_weight = asset(0, get_core_symbol());
-         res.cpu_weight = asset(0, get_core_symbol());
-      });
-
-      eosio::set_resource_limits(name, 0 + ram_gift_bytes, 0, 0);
+      // userres row is created once stake or ram is assigned, no row means zero
+      eosio::set_resource_limits(name, 0 + ram_gift_bytes(), 0, 0);
    }
 }
 
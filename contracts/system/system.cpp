@@ -12,14 +12,23 @@ system::system(name s, name code, datastream<const char*> ds)
 : contract(s, code, ds)
 , _rammarket(_self, _self.value)
 , _global(_self, _self.value) {
-   _gstate = _global.exists() ? _global.get() : get_default_parameters();
-   ram_gift_bytes = _gstate.ram_gift_kbytes * 1024;
 }
 
 system::~system() {
    // empty first receiver means this contract is instantiated in another contract
-   if (get_first_receiver() != name())
-      _global.set(_gstate, _self);
+   if (_gstate_dirty && get_first_receiver() != name())
+      _global.set(*_gstate, _self);
+}
+
+const gxc_global_state& system::gstate() {
+   if (!_gstate) _gstate = _global.exists() ? _global.get() : get_default_parameters();
+   return *_gstate;
+}
+
+gxc_global_state& system::mutable_gstate() {
+   gstate();
+   _gstate_dirty = true;
+   return *_gstate;
 }
 
 gxc_global_state system::get_default_parameters() {
@@ -36,11 +45,11 @@ symbol system::core_symbol()const {
 void system::setram( uint64_t max_ram_size ) {
    require_auth( _self );
 
-   check( _gstate.max_ram_size < max_ram_size, "ram may only be increased" ); /// decreasing ram might result market maker issues
+   check( gstate().max_ram_size < max_ram_size, "ram may only be increased" ); /// decreasing ram might result market maker issues
    check( max_ram_size < 1024ll*1024*1024*1024*1024, "ram size is unrealistic" );
-   check( max_ram_size > _gstate.total_ram_bytes_reserved, "attempt to set max below reserved" );
+   check( max_ram_size > gstate().total_ram_bytes_reserved, "attempt to set max below reserved" );
 
-   auto delta = int64_t(max_ram_size) - int64_t(_gstate.max_ram_size);
+   auto delta = int64_t(max_ram_size) - int64_t(gstate().max_ram_size);
    auto itr = _rammarket.find(ramcore_symbol.raw());
 
    /**
@@ -50,17 +59,18 @@ void system::setram( uint64_t max_ram_size ) {
       m.base.balance.amount += delta;
    });
 
-   _gstate.max_ram_size = max_ram_size;
+   mutable_gstate().max_ram_size = max_ram_size;
 }
 
 void system::update_ram_supply() {
    auto cbt = current_block_time();
 
-   if( cbt <= _gstate.last_ram_increase ) return;
+   if( cbt <= gstate().last_ram_increase ) return;
 
+   auto& gs = mutable_gstate();
    auto itr = _rammarket.find(ramcore_symbol.raw());
-   auto new_ram = (cbt.slot - _gstate.last_ram_increase.slot)*_gstate.new_ram_per_block;
-   _gstate.max_ram_size += new_ram;
+   auto new_ram = (cbt.slot - gs.last_ram_increase.slot)*gs.new_ram_per_block;
+   gs.max_ram_size += new_ram;
 
    /**
     *  Increase the amount of ram for sale based upon the change in max ram size.
@@ -68,7 +78,7 @@ void system::update_ram_supply() {
    _rammarket.modify( itr, same_payer, [&]( auto& m ) {
       m.base.balance.amount += new_ram;
    });
-   _gstate.last_ram_increase = cbt;
+   gs.last_ram_increase = cbt;
 }
 
 /**
@@ -82,13 +92,13 @@ void system::setramrate( uint16_t bytes_per_block ) {
    require_auth( _self );
 
    update_ram_supply();
-   _gstate.new_ram_per_block = bytes_per_block;
+   mutable_gstate().new_ram_per_block = bytes_per_block;
 }
 
 void system::setparams( const gxc::blockchain_parameters& params ) {
    require_auth( _self );
-   (gxc::blockchain_parameters&)(_gstate) = params;
-   check( 3 <= _gstate.max_authority_depth, "max_authority_depth should be at least 3" );
+   (gxc::blockchain_parameters&)(mutable_gstate()) = params;
+   check( 3 <= gstate().max_authority_depth, "max_authority_depth should be at least 3" );
    set_blockchain_parameters( params );
 }
 
@@ -99,10 +109,23 @@ void system::setpriv( name account, uint8_t ispriv ) {
 
 void system::setalimits( name account, int64_t ram, int64_t net, int64_t cpu ) {
    require_auth( _self );
+   set_account_limits( account, ram, net, cpu, ram_gift_bytes() );
+}
+
+void system::setalimitsv( std::vector<std::tuple<name, int64_t, int64_t, int64_t>> limits ) {
+   require_auth( _self );
+
+   auto ram_gift = ram_gift_bytes();
+   for (const auto& [account, ram, net, cpu]: limits)
+      set_account_limits( account, ram, net, cpu, ram_gift );
+}
+
+void system::set_account_limits( name account, int64_t ram, int64_t net, int64_t cpu, int64_t ram_gift ) {
    user_resources_table userres( _self, account.value );
    auto ritr = userres.find( account.value );
    //check( ritr == userres.end(), "only supports unlimited accounts" );
 
+   // without userres row, resources are zero and there is nothing to keep in resmod
    if (ritr != userres.end()) {
       resources_modifier resmod(_self, account.value);
       auto mitr = resmod.find(account.value);
@@ -121,7 +144,7 @@ void system::setalimits( name account, int64_t ram, int64_t net, int64_t cpu ) {
       }
    }
  
-   eosio::set_resource_limits( account, (ram < 0) ? ram : ram + ram_gift_bytes, net, cpu );
+   eosio::set_resource_limits( account, (ram < 0) ? ram : ram + ram_gift, net, cpu );
 }
 
 void system::init(unsigned_int version, symbol core) {
@@ -131,6 +154,9 @@ void system::init(unsigned_int version, symbol core) {
    auto itr = _rammarket.find(ramcore_symbol.raw());
    check(itr == _rammarket.end(), "system contract has already been initialized");
 
+   // global state is otherwise written only by the first action modifying it, so defaults are stored here
+   mutable_gstate();
+
    auto system_token_supply = token().get_supply(extended_symbol_code{core.code(), _self}).quantity;
    check(system_token_supply.symbol == core, "specified core symbol does not exist (precision mismatch)");
    check(system_token_supply.amount >= 0, "system token supply must be greater than 0");
@@ -138,7 +164,7 @@ void system::init(unsigned_int version, symbol core) {
    _rammarket.emplace(_self, [&](auto& m) {
       m.supply.amount = 100'000'000'000'000ll;
       m.supply.symbol = ramcore_symbol;
-      m.base.balance.amount = int64_t(_gstate.free_ram());
+      m.base.balance.amount = int64_t(gstate().free_ram());
       m.base.balance.symbol = ram_symbol;
       m.quote.balance.amount = system_token_supply.amount / 1000;
       m.quote.balance.symbol = core;
@@ -181,6 +207,25 @@ void system::genaccount(name creator, name name, authority owner, authority acti
    _account.setnick(name, nickname);
 }
 
+void system::genaccounts(name creator, std::vector<account_item> accounts) {
+   require_auth(creator);
+   check(!accounts.empty(), "no account to create");
+
+   newaccount_action create(_self, {{creator, active_permission}, {_self, active_permission}});
+
+   std::vector<account::nick_item> nicks;
+   nicks.reserve(accounts.size());
+
+   for (const auto& a: accounts) {
+      create.send(creator, a.account, a.owner, a.active);
+      nicks.push_back({a.account, a.nickname});
+   }
+
+   account _account;
+   _account.authorization = {{_self, active_permission}};
+   _account.setnicks(nicks);
+}
+
 void system::setprods( std::vector<eosio::producer_key> schedule ) {
    (void)schedule; // schedule argument just forces the deserialization of the action data into vector<producer_key> (necessary check)
    require_auth( _self );
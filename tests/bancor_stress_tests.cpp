@@ -0,0 +1,167 @@
+#include "bancor_tester.hpp"
+#include <bancor_quote/quote_engine.hpp>
+
+#include <cmath>
+#include <iomanip>
+#include <random>
+
+using namespace gxc::bancor_quote;
+
+class gxc_bancor_stress_tester : public gxc_bancor_reserve_tester {
+public:
+
+   // pushes convert in its own transaction to get billed cpu
+   transaction_trace_ptr push_convert(account_name sender, extended_asset from, extended_asset to) {
+      return push_trx(bancor_account_name, N(convert), sender, mvo()
+         ("sender", sender)
+         ("from", from)
+         ("to", to)
+      );
+   }
+};
+
+namespace {
+
+struct path_stats {
+   const char* name;
+   uint64_t    succeeded = 0;
+   uint64_t    failed = 0;
+   uint64_t    cpu_total = 0;
+   uint32_t    cpu_max = 0;
+};
+
+uint64_t stress_iterations() {
+   auto env = std::getenv("BANCOR_STRESS_ITERATIONS");
+   return env ? std::strtoull(env, nullptr, 10) : 100000;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(gxc_bancor_stress_tests)
+
+// Reports billed cpu per conversion path and rounding drift of connector balance against
+// the analytic curve, C = C0 * (S / S0) ^ (1 / weight), checking balances and supplies after
+// every conversion. Set BANCOR_STRESS_ITERATIONS to change the number of conversions, and
+// BANCOR_TEST_SEED to take another path than the fixed default.
+BOOST_FIXTURE_TEST_CASE(convert_stress_and_drift, gxc_bancor_stress_tester, BENCHMARK) try {
+   const char* smarts[] = { "HOBL@conr2d", "RSV@conr2d" };
+   const charge charges[] = { {10, 0}, {0, 0} };
+   const side sides[] = { side::buy, side::buy_exact, side::sell, side::sell_exact };
+
+   BOOST_REQUIRE_EQUAL(success(), setcharge(10, {symbol(4, "HOBL"), N(conr2d)}));
+   // sender holds the whole supply of both, so it can fund every conversion below max supply
+   BOOST_REQUIRE_EQUAL(success(), transfer(N(conr2d), N(eun2ce), EA("10000000.0000 HOBL@conr2d"), ""));
+   approve(N(eun2ce), bancor_account_name, EA("100000000000.0000 GXC@gxc"));
+   approve(N(eun2ce), bancor_account_name, EA("100000000000.0000 HOBL@conr2d"));
+   approve(N(eun2ce), bancor_account_name, EA("100000000000.0000 RSV@conr2d"));
+   produce_blocks(1);
+
+   path_stats stats[2][4] = {
+      {{"HOBL buy"}, {"HOBL buy_exact"}, {"HOBL sell"}, {"HOBL sell_exact"}},
+      {{"RSV buy"}, {"RSV buy_exact"}, {"RSV sell"}, {"RSV sell_exact"}}
+   };
+
+   // analytic curve is defined only for the connector without reserve
+   auto conn = get_connector("HOBL@conr2d");
+   const double C0 = asset::from_string(conn["balance"].as_string()).get_amount();
+   const double S0 = get_supply("HOBL@conr2d");
+   const double weight = conn["weight"].as_double();
+   double max_drift = 0;
+
+   auto env = std::getenv("BANCOR_TEST_SEED");
+   uint64_t seed = env ? std::strtoull(env, nullptr, 10) : 20190716;
+   std::cout << "bancor stress seeded to " << seed << std::endl;
+   std::mt19937_64 rng(seed);
+   std::uniform_int_distribution<int> pick(0, 7);
+   std::lognormal_distribution<double> size(std::log(1000000.), 2.);
+
+   auto connector_balance = [&](const char* sym) {
+      return asset::from_string(get_connector(sym)["balance"].as_string()).get_amount();
+   };
+
+   const auto iterations = stress_iterations();
+   for (uint64_t i = 0; i < iterations; ++i) {
+      auto n = pick(rng);
+      auto c = n / 4, p = n % 4;
+      auto amount = std::max<int64_t>(1, std::min<int64_t>(int64_t(size(rng)), 100000000000ll));
+
+      auto sc = SC(smarts[c]);
+      extended_asset gxc{asset(0, symbol(4, "GXC")), N(gxc)};
+      extended_asset smart{asset(0, symbol(4, sc.code.to_string().c_str())), sc.contract};
+
+      switch (p) {
+         case 0: gxc.quantity = asset(amount, gxc.quantity.get_symbol()); break;
+         case 1: smart.quantity = asset(amount, smart.quantity.get_symbol()); break;
+         case 2: smart.quantity = asset(amount, smart.quantity.get_symbol()); break;
+         case 3: gxc.quantity = asset(amount, gxc.quantity.get_symbol()); break;
+      }
+
+      auto supply = get_supply(smarts[c]);
+      auto max_supply = asset::from_string(get_stats(smarts[c])["max_supply"].as_string()).get_amount();
+      auto balance = connector_balance(smarts[c]);
+      auto gxc_before = get_balance(N(eun2ce), "GXC@gxc");
+      auto smart_before = get_balance(N(eun2ce), smarts[c]);
+
+      book b;
+      b.add(pool{ double(supply), double(balance), get_connector(smarts[c])["weight"].as_double(), 4, 4, get_reserve_rate(smarts[c]) }, charges[c]);
+      quote q;
+      quote_all(b, sides[p], &amount, &q);
+
+      // a conversion quoted without error fails only if it overdraws sender or exceeds max supply
+      bool funded = !q.error && q.connected <= gxc_before && -q.smart <= smart_before && supply + q.smart <= max_supply;
+
+      auto& st = stats[c][p];
+      try {
+         auto trace = (p < 2) ? push_convert(N(eun2ce), gxc, smart) : push_convert(N(eun2ce), smart, gxc);
+         BOOST_REQUIRE_MESSAGE(funded, "conversion " << i << " succeeded though quoted to fail");
+         auto cpu = trace->receipt->cpu_usage_us;
+         st.succeeded++;
+         st.cpu_total += cpu;
+         st.cpu_max = std::max(st.cpu_max, cpu);
+      } catch (const fc::exception& e) {
+         BOOST_REQUIRE_MESSAGE(!funded, "conversion quoted as valid failed: " << e.to_detail_string());
+         st.failed++;
+         q = quote();
+      }
+
+      // failed conversion leaves everything untouched, and a quote may be a unit off
+      // as std::pow of glibc and pow of the contract may round the last bit differently
+      auto require_near = [](int64_t expected, int64_t actual) {
+         BOOST_REQUIRE_LE(std::abs(expected - actual), 1);
+      };
+      require_near(balance + q.balance, connector_balance(smarts[c]));
+      require_near(supply + q.smart, get_supply(smarts[c]));
+      require_near(gxc_before - q.connected, get_balance(N(eun2ce), "GXC@gxc"));
+      require_near(smart_before + q.smart, get_balance(N(eun2ce), smarts[c]));
+
+      // bancor keeps nothing but connector balances, and the mirror follows token supply
+      BOOST_REQUIRE_EQUAL(connector_balance(smarts[0]) + connector_balance(smarts[1]), get_balance(bancor_account_name, "GXC@gxc"));
+      auto row = get_connector(smarts[c]).get_object();
+      BOOST_REQUIRE(!row.contains("supply") || asset::from_string(row["supply"].as_string()).get_amount() == get_supply(smarts[c]));
+
+      if (c == 0) {
+         double C = connector_balance(smarts[0]);
+         double drift = C - C0 * std::pow(get_supply("HOBL@conr2d") / S0, 1. / weight);
+         max_drift = std::max(max_drift, std::abs(drift));
+      }
+
+      if (i % 100 == 99) produce_blocks(1);
+   }
+
+   double C = connector_balance(smarts[0]);
+   double drift = C - C0 * std::pow(get_supply("HOBL@conr2d") / S0, 1. / weight);
+
+   std::cout << "bancor stress: " << iterations << " conversions" << std::endl;
+   std::cout << "   path               ok   failed   avg cpu(us)   max cpu(us)" << std::endl;
+   for (auto& row: stats) {
+      for (auto& st: row) {
+         std::cout << "   " << std::left << std::setw(16) << st.name << std::right
+                   << std::setw(6) << st.succeeded << std::setw(9) << st.failed
+                   << std::setw(14) << (st.succeeded ? st.cpu_total / st.succeeded : 0)
+                   << std::setw(14) << st.cpu_max << std::endl;
+      }
+   }
+   std::cout << "   HOBL connector balance drift: " << drift << " (max " << max_drift << ") in raw amount" << std::endl;
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "token_tester.hpp"
+
+const static name bancor_account_name = N(gxc.bancor);
+
+class gxc_bancor_tester : public gxc_token_tester {
+public:
+
+   gxc_bancor_tester() {
+      create_accounts({ bancor_account_name });
+      produce_blocks(1);
+
+      _set_code(bancor_account_name, contracts::bancor_wasm());
+      _set_abi(bancor_account_name, contracts::bancor_abi().data());
+      produce_blocks(1);
+
+      // smart token is issued by bancor on behalf of its issuer
+      set_authority(N(conr2d), config::active_name,
+         authority(1, {key_weight{get_public_key(N(conr2d), "active"), 1}}, {permission_level_weight{{bancor_account_name, config::eosio_code_name}, 1}}),
+         config::owner_name, {{N(conr2d), config::owner_name}}, {get_private_key(N(conr2d), "owner")}
+      );
+
+      auto accnt = control->db().get<account_object,by_name>(bancor_account_name);
+      abi_def abi;
+      BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
+      abi_ser[bancor_account_name].set_abi(abi, abi_serializer_max_time);
+
+      mint(EA("1000000000.0000 GXC@gxc"));
+      mint(EA("1000000000.0000 HOBL@conr2d"));
+      transfer(config::null_account_name, N(ian), EA("100000000.0000 GXC@gxc"), "");
+      transfer(config::null_account_name, N(eun2ce), EA("100000000.0000 GXC@gxc"), "");
+      transfer(config::null_account_name, N(conr2d), EA("10000000.0000 HOBL@conr2d"), "");
+      produce_blocks(1);
+
+      approve(N(ian), bancor_account_name, EA("100000000.0000 GXC@gxc"));
+      approve(N(eun2ce), bancor_account_name, EA("100000000.0000 GXC@gxc"));
+      approve(N(eun2ce), bancor_account_name, EA("1000000000.0000 HOBL@conr2d"));
+
+      BOOST_REQUIRE_EQUAL(success(), init(N(ian), {symbol(4, "GXC"), N(gxc)}));
+      BOOST_REQUIRE_EQUAL(success(), connect({symbol(4, "HOBL"), N(conr2d)}, EA("1000000.0000 GXC@gxc"), .5));
+      produce_blocks(1);
+   }
+
+   fc::variant get_connector(const string& symbol_name) {
+      auto symbol_code = SC(symbol_name);
+      return get_table_row(bancor_account_name, symbol_code.contract, N(connector), symbol_code.code);
+   }
+
+   int64_t get_supply(const string& symbol_name) {
+      return asset::from_string(get_stats(symbol_name)["supply"].as_string()).get_amount();
+   }
+
+   static fc::variant to_variant(const extended_symbol& sym) {
+      return mvo()("sym", sym.sym)("contract", sym.contract);
+   }
+
+   action_result convert(account_name sender, extended_asset from, extended_asset to) {
+      return PUSH_ACTION(bancor_account_name, sender, (sender)(from)(to));
+   }
+
+   action_result convertmany(account_name sender, vector<pair<extended_asset, extended_asset>> conversions) {
+      return PUSH_ACTION(bancor_account_name, sender, (sender)(conversions));
+   }
+
+   action_result init(account_name admin, extended_symbol connected) {
+      return push_action(bancor_account_name, N(init), bancor_account_name, mvo()
+         ("admin", admin)
+         ("connected", to_variant(connected))
+      );
+   }
+
+   action_result connect(extended_symbol smart, extended_asset balance, double weight) {
+      return push_action(bancor_account_name, N(connect), N(ian), mvo()
+         ("smart", to_variant(smart))
+         ("balance", balance)
+         ("weight", weight)
+      );
+   }
+
+   action_result setcharge(int16_t rate, extended_symbol smart) {
+      return push_action(bancor_account_name, N(setcharge), N(ian), mvo()
+         ("rate", rate)
+         ("fixed", fc::variant())
+         ("smart", to_variant(smart))
+      );
+   }
+
+   action_result reconcile(extended_symbol smart, account_name actor = N(ian)) {
+      return push_action(bancor_account_name, N(reconcile), actor, mvo()
+         ("smart", to_variant(smart))
+      );
+   }
+};
+
+const static name reserve_account_name = N(gxc.reserve);
+const static name account_account_name = N(gxc.account);
+
+// RSV@conr2d is backed by gxc.reserve, so selling it below the reserve rate claims GXC from reserve
+class gxc_bancor_reserve_tester : public gxc_bancor_tester {
+public:
+
+   gxc_bancor_reserve_tester() {
+      create_accounts({ reserve_account_name, account_account_name });
+      produce_blocks(1);
+
+      _set_code(reserve_account_name, contracts::reserve_wasm());
+      _set_abi(reserve_account_name, contracts::reserve_abi().data());
+      _set_code(account_account_name, contracts::account_wasm());
+      _set_abi(account_account_name, contracts::account_abi().data());
+      produce_blocks(1);
+
+      // reserve mints and burns derivative token
+      set_authority(token_account_name, config::active_name,
+         authority(1, {key_weight{get_public_key(token_account_name, "active"), 1}}, {
+            permission_level_weight{{reserve_account_name, config::eosio_code_name}, 1},
+            permission_level_weight{{token_account_name, config::eosio_code_name}, 1}
+         }),
+         config::owner_name, {{token_account_name, config::owner_name}}, {get_private_key(token_account_name, "owner")}
+      );
+
+      base_tester::push_action(account_account_name, N(setpartner), account_account_name, mvo()
+         ("name", N(conr2d))
+         ("is_partner", true)
+      );
+
+      transfer(config::null_account_name, N(conr2d), EA("1000000.0000 GXC@gxc"), "");
+      approve(N(conr2d), reserve_account_name, EA("100000.0000 GXC@gxc"));
+      base_tester::push_action(reserve_account_name, N(mint), N(conr2d), mvo()
+         ("derivative", EA("1000000.0000 RSV@conr2d"))
+         ("underlying", EA("100000.0000 GXC@gxc"))
+         ("opts", vector<option>())
+      );
+      // initial supply of the curve
+      transfer(config::null_account_name, N(eun2ce), EA("100000.0000 RSV@conr2d"), "");
+      approve(N(eun2ce), bancor_account_name, EA("1000000.0000 RSV@conr2d"));
+      produce_blocks(1);
+
+      // priced at .02 GXC, below the reserve rate of .1 GXC
+      BOOST_REQUIRE_EQUAL(success(), connect({symbol(4, "RSV"), N(conr2d)}, EA("1000.0000 GXC@gxc"), .5));
+      produce_blocks(1);
+
+      auto accnt = control->db().get<account_object,by_name>(reserve_account_name);
+      abi_def abi;
+      BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
+      abi_ser[reserve_account_name].set_abi(abi, abi_serializer_max_time);
+   }
+
+   double get_reserve_rate(const string& symbol_name) {
+      auto symbol_code = SC(symbol_name);
+      auto row = get_table_row(reserve_account_name, symbol_code.contract, N(reserves), symbol_code.code);
+      return row.is_null() ? 0. : row["rate"].as_double();
+   }
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "token_tester.hpp"
+
+const static name gacha_account_name = N(gxc.gacha);
+const static name account_account_name = N(gxc.account);
+
+class gxc_gacha_tester : public gxc_token_tester {
+public:
+
+   gxc_gacha_tester() {
+      create_accounts({ gacha_account_name, account_account_name });
+      produce_blocks(1);
+
+      _set_code(gacha_account_name, contracts::gacha_wasm());
+      _set_abi(gacha_account_name, contracts::gacha_abi().data());
+      _set_code(account_account_name, contracts::account_wasm());
+      _set_abi(account_account_name, contracts::account_abi().data());
+      produce_blocks(1);
+
+      // gacha sends drawresult and reward transfers inline on its own
+      set_authority(gacha_account_name, config::active_name,
+         authority(1, {key_weight{get_public_key(gacha_account_name, "active"), 1}}, {permission_level_weight{{gacha_account_name, config::eosio_code_name}, 1}}),
+         config::owner_name, {{gacha_account_name, config::owner_name}}, {get_private_key(gacha_account_name, "owner")}
+      );
+
+      auto accnt = control->db().get<account_object,by_name>(gacha_account_name);
+      abi_def abi;
+      BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
+      abi_ser[gacha_account_name].set_abi(abi, abi_serializer_max_time);
+
+      base_tester::push_action(account_account_name, N(setpartner), account_account_name, mvo()
+         ("name", N(conr2d))
+         ("is_partner", true)
+      );
+
+      mint(EA("1000000000.0000 HOBL@conr2d"));
+      transfer(config::null_account_name, N(conr2d), EA("100000000.0000 HOBL@conr2d"), "");
+      approve(N(conr2d), gacha_account_name, EA("100000000.0000 HOBL@conr2d"));
+      produce_blocks(1);
+   }
+
+   static fc::variant to_variant(const string& scheme_name, account_name contract) {
+      return mvo()("name", scheme_name)("contract", contract);
+   }
+
+   static fc::variant make_grade(const string& reward, uint32_t score, optional<uint32_t> limit = {}) {
+      return mvo()("reward", reward)("score", score)("limit", limit ? fc::variant(*limit) : fc::variant());
+   }
+
+   static fc::sha256 make_dseedhash(const fc::sha256& dseed) {
+      return fc::sha256::hash(dseed.data(), dseed.data_size());
+   }
+
+   // merkle tree over hash of dseeds, padded by duplicating the last leaf
+   static vector<vector<fc::sha256>> make_merkle_tree(const vector<fc::sha256>& dseeds) {
+      vector<vector<fc::sha256>> levels(1);
+      for (const auto& d: dseeds) levels[0].emplace_back(make_dseedhash(d));
+      while (levels.back().size() > 1) {
+         auto& level = levels.back();
+         if (level.size() % 2) level.push_back(fc::sha256(level.back()));
+         vector<fc::sha256> next;
+         for (size_t i = 0; i < level.size(); i += 2) {
+            char buf[64];
+            memcpy(buf, level[i].data(), 32);
+            memcpy(buf + 32, level[i+1].data(), 32);
+            next.emplace_back(fc::sha256::hash(buf, sizeof(buf)));
+         }
+         levels.emplace_back(std::move(next));
+      }
+      return levels;
+   }
+
+   static vector<fc::sha256> make_merkle_proof(const vector<vector<fc::sha256>>& tree, uint32_t index) {
+      vector<fc::sha256> proof;
+      for (size_t l = 0; l + 1 < tree.size(); ++l, index >>= 1) {
+         proof.emplace_back(tree[l][index ^ 1]);
+      }
+      return proof;
+   }
+
+   fc::variant get_scheme(account_name contract, const string& scheme_name) {
+      return get_table_row(gacha_account_name, contract, N(schemecfg), name(scheme_name).value, "scheme");
+   }
+
+   fc::variant get_grade(account_name contract, const string& scheme_name, uint32_t score) {
+      uint64_t key = std::numeric_limits<uint32_t>::max() - score;
+      return find_table_row(gacha_account_name, contract, N(grade), "_grade", [&](const fc::variant& g) {
+         return g["scheme_name"].as_string() == scheme_name && g["key"].as_uint64() == key;
+      });
+   }
+
+   fc::variant get_schemestat(account_name contract, const string& scheme_name) {
+      return get_table_row(gacha_account_name, contract, N(schemestat), name(scheme_name).value);
+   }
+
+   fc::variant get_batch(uint64_t id) {
+      return get_table_row(gacha_account_name, N(conr2d), N(batch), id);
+   }
+
+   fc::variant get_reward(account_name owner, const string& symbol_name) {
+      auto symbol_code = SC(symbol_name);
+      return get_table_row(gacha_account_name, owner, N(reward), XXH64((const void*)&symbol_code, sizeof(extended_symbol_code), 0));
+   }
+
+   fc::variant get_pending(uint64_t id) {
+      return get_table_row(gacha_account_name, N(conr2d), N(pending), id);
+   }
+
+   fc::variant get_due(uint64_t id) {
+      return find_table_row(gacha_account_name, gacha_account_name, N(due), "", [&](const fc::variant& d) {
+         return d["contract"].as<account_name>() == N(conr2d) && d["id"].as_uint64() == id;
+      });
+   }
+
+   fc::variant get_gacha(uint64_t id) {
+      return get_table_row(gacha_account_name, N(conr2d), N(opened), id, "_gacha");
+   }
+
+   action_result open(const string& scheme_name, const vector<fc::variant>& grades, extended_asset budget, time_point_sec expiration, uint8_t precision, uint32_t deadline_sec, bool instant = false) {
+      return push_action(gacha_account_name, N(open), N(conr2d), mvo()
+         ("scheme", to_variant(scheme_name, N(conr2d)))
+         ("grades", grades)
+         ("budget", budget)
+         ("expiration", expiration)
+         ("precision", precision)
+         ("deadline_sec", deadline_sec)
+         ("instant", instant)
+      );
+   }
+
+   action_result close(const string& scheme_name) {
+      return push_action(gacha_account_name, N(close), N(conr2d), mvo()
+         ("scheme", to_variant(scheme_name, N(conr2d)))
+      );
+   }
+
+   action_result migrate(account_name actor, const string& scheme_name) {
+      return push_action(gacha_account_name, N(migrate), actor, mvo()
+         ("scheme", to_variant(scheme_name, N(conr2d)))
+      );
+   }
+
+   action_result migrategacha(account_name actor, uint32_t max_items) {
+      return push_action(gacha_account_name, N(migrategacha), actor, mvo()
+         ("max_items", max_items)
+      );
+   }
+
+   action_result issue(account_name to, const string& scheme_name, const fc::sha256& dseedhash, uint64_t id, uint16_t pulls = 1) {
+      return push_action(gacha_account_name, N(issue), N(conr2d), mvo()
+         ("to", to)
+         ("scheme", to_variant(scheme_name, N(conr2d)))
+         ("dseedhash", dseedhash)
+         ("id", id)
+         ("pulls", pulls)
+         ("instant", fc::variant())
+      );
+   }
+
+   // instant issue is authorized by both dealer and owner
+   transaction_trace_ptr push_issue_instant(account_name to, const string& scheme_name, const fc::sha256& dseed, const fc::sha256& oseed, uint64_t id, uint16_t pulls = 1) {
+      signed_transaction trx;
+      trx.actions.emplace_back(get_action(gacha_account_name, N(issue), vector<permission_level>{{N(conr2d), config::active_name}, {to, config::active_name}}, mvo()
+         ("to", to)
+         ("scheme", to_variant(scheme_name, N(conr2d)))
+         ("dseedhash", make_dseedhash(dseed))
+         ("id", id)
+         ("pulls", pulls)
+         ("instant", mvo()("dseed", dseed)("oseed", oseed))
+      ));
+      set_transaction_headers(trx);
+      trx.sign(get_private_key(N(conr2d), "active"), control->get_chain_id());
+      trx.sign(get_private_key(to, "active"), control->get_chain_id());
+      auto trace = push_transaction(trx);
+      produce_block();
+      return trace;
+   }
+
+   action_result issue_instant(account_name to, const string& scheme_name, const fc::sha256& dseed, const fc::sha256& oseed, uint64_t id, uint16_t pulls = 1) {
+      try {
+         push_issue_instant(to, scheme_name, dseed, oseed, id, pulls);
+      } catch (const fc::exception& ex) {
+         return error(ex.top_message());
+      }
+      return success();
+   }
+
+   action_result issuebatch(const string& scheme_name, const fc::sha256& root, const vector<fc::variant>& tickets) {
+      return push_action(gacha_account_name, N(issuebatch), N(conr2d), mvo()
+         ("scheme", to_variant(scheme_name, N(conr2d)))
+         ("root", root)
+         ("tickets", tickets)
+      );
+   }
+
+   action_result setoseed(account_name owner, uint64_t id, const fc::sha256& oseed) {
+      return push_action(gacha_account_name, N(setoseed), owner, mvo()
+         ("contract", N(conr2d))
+         ("id", id)
+         ("oseed", oseed)
+      );
+   }
+
+   action_result setdseed(uint64_t id, const fc::sha256& dseed) {
+      return push_action(gacha_account_name, N(setdseed), N(conr2d), mvo()
+         ("contract", N(conr2d))
+         ("id", id)
+         ("dseed", dseed)
+      );
+   }
+
+   action_result reveal(const vector<fc::variant>& items) {
+      return push_action(gacha_account_name, N(reveal), N(conr2d), mvo()
+         ("contract", N(conr2d))
+         ("items", items)
+      );
+   }
+
+   action_result resolve(account_name actor, uint32_t max_items) {
+      return push_action(gacha_account_name, N(resolve), actor, mvo()
+         ("max_items", max_items)
+      );
+   }
+
+   action_result claim(account_name owner) {
+      return push_action(gacha_account_name, N(claim), owner, mvo()
+         ("owner", owner)
+      );
+   }
+
+   // pushes an action in its own transaction to get billed cpu};
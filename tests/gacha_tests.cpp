@@ -0,0 +1,643 @@
+#include "gacha_tester.hpp"
+#include "gacha_verify/trace.hpp"
+#include "gacha_verify/verifier.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+uint64_t resolve_tickets() {
+   auto env = std::getenv("GACHA_RESOLVE_TICKETS");
+   return env ? std::strtoull(env, nullptr, 10) : 10000;
+}
+
+// grades with descending scores evenly spread over 4 bytes, every other grade limited
+vector<fc::variant> make_grades(uint32_t count) {
+   vector<fc::variant> grades;
+   for (uint32_t i = 0; i < count; ++i) {
+      auto score = uint32_t(uint64_t(std::numeric_limits<uint32_t>::max()) * (count - i) / (count + 1));
+      grades.emplace_back(gxc_gacha_tester::make_grade("0.0001 HOBL", score, (i % 2) ? optional<uint32_t>(1000000) : optional<uint32_t>()));
+   }
+   return grades;
+}
+
+gxc::gacha_verify::checksum to_checksum(const fc::sha256& h) {
+   gxc::gacha_verify::checksum c;
+   memcpy(c.data(), h.data(), c.size());
+   return c;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(gxc_gacha_tests)
+
+BOOST_FIXTURE_TEST_CASE(draw_updates_stat_only, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", make_grades(5), EA("100.0000 HOBL@conr2d"), expiration, 4, 3600));
+   auto scheme = get_scheme(N(conr2d), "hobl");
+
+   auto dseed = fc::sha256::hash(string("dseed"));
+   BOOST_REQUIRE_EQUAL(success(), issue(N(eun2ce), "hobl", make_dseedhash(dseed), 1));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("oseed is not set"), setdseed(1, dseed));
+   BOOST_REQUIRE(get_gacha(1).is_null());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("invalid oseed"), setoseed(N(eun2ce), 1, fc::sha256()));
+   BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), 1, fc::sha256::hash(string("oseed"))));
+   BOOST_REQUIRE(get_pending(1).is_null());
+   BOOST_REQUIRE_EQUAL(get_gacha(1)["deadline"].as_string(), get_due(1)["deadline"].as_string());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("oseed is already set"), setoseed(N(eun2ce), 1, fc::sha256::hash(string("oseed"))));
+   REQUIRE_MATCHING_OBJECT(get_schemestat(N(conr2d), "hobl"), mvo()
+      ("scheme_name", "hobl")
+      ("out", "0.0000 HOBL")
+      ("issued", 1)
+      ("unresolved", 1)
+   );
+
+   BOOST_REQUIRE_EQUAL(success(), setdseed(1, dseed));
+   BOOST_REQUIRE(get_gacha(1).is_null());
+   BOOST_REQUIRE(get_due(1).is_null());
+   BOOST_REQUIRE_EQUAL(0, get_schemestat(N(conr2d), "hobl")["unresolved"].as_uint64());
+   BOOST_REQUIRE_EQUAL(fc::json::to_string(scheme), fc::json::to_string(get_scheme(N(conr2d), "hobl")));
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(multi_pull, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", make_grades(5), EA("100.0000 HOBL@conr2d"), expiration, 4, 3600));
+
+   auto dseed = fc::sha256::hash(string("dseed"));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("invalid number of pulls"), issue(N(eun2ce), "hobl", make_dseedhash(dseed), 1, 0));
+   BOOST_REQUIRE_EQUAL(success(), issue(N(eun2ce), "hobl", make_dseedhash(dseed), 1, 10));
+   BOOST_REQUIRE_EQUAL(10, get_pending(1)["pulls"].as_uint64());
+   BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), 1, fc::sha256::hash(string("oseed"))));
+   BOOST_REQUIRE_EQUAL(10, get_gacha(1)["pulls"].as_uint64());
+
+   auto balance = get_balance(N(eun2ce), "HOBL@conr2d");
+   BOOST_REQUIRE_EQUAL(success(), setdseed(1, dseed));
+   BOOST_REQUIRE(get_gacha(1).is_null());
+
+   auto stat = get_schemestat(N(conr2d), "hobl");
+   BOOST_REQUIRE_EQUAL(10, stat["issued"].as_uint64());
+   BOOST_REQUIRE_EQUAL(0, stat["unresolved"].as_uint64());
+   BOOST_REQUIRE_EQUAL(balance, get_balance(N(eun2ce), "HOBL@conr2d"));
+   BOOST_REQUIRE_EQUAL(stat["out"].as_string() + "@conr2d", get_reward(N(eun2ce), "HOBL@conr2d")["balance"].as_string());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(claim_reward, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", { make_grade("1.0000 HOBL", 0) }, EA("100.0000 HOBL@conr2d"), expiration, 1, 3600));
+
+   auto& rlm = control->get_resource_limits_manager();
+   auto ram = rlm.get_account_ram_usage(N(eun2ce));
+
+   vector<fc::sha256> dseeds;
+   for (uint64_t id = 1; id <= 3; ++id) {
+      dseeds.emplace_back(fc::sha256::hash(std::to_string(id)));
+      BOOST_REQUIRE_EQUAL(success(), issue(N(eun2ce), "hobl", make_dseedhash(dseeds.back()), id));
+      BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), id, fc::sha256::hash(string("oseed"))));
+   }
+
+   // owner pays for the row of reward when opening the first gacha
+   BOOST_REQUIRE_EQUAL("0.0000 HOBL@conr2d", get_reward(N(eun2ce), "HOBL@conr2d")["balance"].as_string());
+   BOOST_REQUIRE(rlm.get_account_ram_usage(N(eun2ce)) > ram);
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no reward to claim"), claim(N(eun2ce)));
+   BOOST_REQUIRE_EQUAL(success(), setdseed(1, dseeds[0]));
+
+   // outcomes of gacha revealed together are notified once
+   auto trace = push_trx(gacha_account_name, N(reveal), N(conr2d), mvo()
+      ("contract", N(conr2d))
+      ("items", vector<fc::variant>{
+         mvo()("id", 2)("dseed", dseeds[1])("proof", vector<fc::sha256>()),
+         mvo()("id", 3)("dseed", dseeds[2])("proof", vector<fc::sha256>())
+      })
+   );
+   vector<fc::variant> results;
+   for (const auto& at: trace->action_traces) {
+      if (at.receiver != gacha_account_name || at.act.name != N(drawresult)) continue;
+      auto data = abi_ser[gacha_account_name].binary_to_variant("drawresult", at.act.data, abi_serializer_max_time);
+      BOOST_REQUIRE_EQUAL("eun2ce", data["owner"].as_string());
+      results.emplace_back(data["results"]);
+   }
+   BOOST_REQUIRE_EQUAL(1, results.size());
+   BOOST_REQUIRE_EQUAL(2, results[0].get_array().size());
+   BOOST_REQUIRE_EQUAL("3.0000 HOBL@conr2d", get_reward(N(eun2ce), "HOBL@conr2d")["balance"].as_string());
+
+   auto balance = get_balance(N(eun2ce), "HOBL@conr2d");
+   BOOST_REQUIRE_EQUAL(success(), claim(N(eun2ce)));
+   BOOST_REQUIRE_EQUAL(30000, get_balance(N(eun2ce), "HOBL@conr2d") - balance);
+   BOOST_REQUIRE(get_reward(N(eun2ce), "HOBL@conr2d").is_null());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(batch_reveal, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", make_grades(5), EA("100.0000 HOBL@conr2d"), expiration, 4, 3600));
+
+   vector<fc::sha256> dseeds;
+   vector<fc::variant> tickets;
+   for (uint64_t id = 1; id <= 5; ++id) {
+      dseeds.emplace_back(fc::sha256::hash(std::to_string(id)));
+      tickets.emplace_back(mvo()("to", N(eun2ce))("id", id)("pulls", fc::variant()));
+   }
+   auto tree = make_merkle_tree(dseeds);
+   auto root = tree.back()[0];
+
+   BOOST_REQUIRE_EQUAL(success(), issuebatch("hobl", root, tickets));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("existing batch"), issuebatch("hobl", root, tickets));
+   for (uint64_t id = 1; id <= 5; ++id) {
+      BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), id, fc::sha256::hash(string("oseed"))));
+   }
+
+   auto batch_id = get_gacha(1)["dseedhash"][1]["batch"].as_uint64();
+   REQUIRE_MATCHING_OBJECT(get_batch(batch_id), mvo()
+      ("id", batch_id)
+      ("root", root)
+      ("size", 5)
+      ("remaining", 5)
+   );
+
+   // proof of another leaf
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("hash mismatch"), reveal({
+      mvo()("id", 1)("dseed", dseeds[0])("proof", make_merkle_proof(tree, 1))
+   }));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("invalid proof length"), reveal({
+      mvo()("id", 1)("dseed", dseeds[0])("proof", vector<fc::sha256>())
+   }));
+
+   BOOST_REQUIRE_EQUAL(success(), reveal({
+      mvo()("id", 1)("dseed", dseeds[0])("proof", make_merkle_proof(tree, 0)),
+      mvo()("id", 4)("dseed", dseeds[3])("proof", make_merkle_proof(tree, 3))
+   }));
+   BOOST_REQUIRE(get_gacha(1).is_null());
+   BOOST_REQUIRE(get_gacha(4).is_null());
+   BOOST_REQUIRE_EQUAL(3, get_batch(batch_id)["remaining"].as_uint64());
+
+   vector<fc::variant> items;
+   for (uint32_t i: {1, 2, 4}) {
+      items.emplace_back(mvo()("id", i + 1)("dseed", dseeds[i])("proof", make_merkle_proof(tree, i)));
+   }
+   BOOST_REQUIRE_EQUAL(success(), reveal(items));
+   BOOST_REQUIRE(get_batch(batch_id).is_null());
+   BOOST_REQUIRE_EQUAL(0, get_schemestat(N(conr2d), "hobl")["unresolved"].as_uint64());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(grade_limit_fallback, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   // with 1-byte score, every score but 0 hits the limited grade first
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", {
+      make_grade("1.0000 HOBL", 1, 1),
+      make_grade("0.0001 HOBL", 0)
+   }, EA("100.0000 HOBL@conr2d"), expiration, 1, 3600));
+
+   auto dseed = fc::sha256::hash(string("dseed"));
+   BOOST_REQUIRE_EQUAL(success(), issue(N(eun2ce), "hobl", make_dseedhash(dseed), 1, 20));
+   BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), 1, fc::sha256::hash(string("oseed"))));
+   BOOST_REQUIRE_EQUAL(success(), setdseed(1, dseed));
+
+   auto top = get_grade(N(conr2d), "hobl", 1)["out_count"].as_uint64();
+   auto rest = get_grade(N(conr2d), "hobl", 0)["out_count"].as_uint64();
+   BOOST_REQUIRE_EQUAL(1, top);
+   BOOST_REQUIRE_EQUAL(19, rest);
+   BOOST_REQUIRE_EQUAL("1.0019 HOBL", get_schemestat(N(conr2d), "hobl")["out"].as_string());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(grades_scoped_by_scheme, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", {
+      make_grade("1.0000 HOBL", 1, 1)
+   }, EA("100.0000 HOBL@conr2d"), expiration, 1, 3600));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl2", {
+      make_grade("0.0001 HOBL", 0)
+   }, EA("100.0000 HOBL@conr2d"), expiration, 1, 3600));
+
+   auto dseed = fc::sha256::hash(string("dseed"));
+   BOOST_REQUIRE_EQUAL(success(), issue(N(eun2ce), "hobl", make_dseedhash(dseed), 1, 20));
+   BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), 1, fc::sha256::hash(string("oseed"))));
+   BOOST_REQUIRE_EQUAL(success(), setdseed(1, dseed));
+
+   // pulls past the limited grade raincheck instead of falling into grades of the next scheme
+   BOOST_REQUIRE_EQUAL(1, get_grade(N(conr2d), "hobl", 1)["out_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(0, get_grade(N(conr2d), "hobl2", 0)["out_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL("1.0000 HOBL", get_schemestat(N(conr2d), "hobl")["out"].as_string());
+   BOOST_REQUIRE_EQUAL("0.0000 HOBL", get_schemestat(N(conr2d), "hobl2")["out"].as_string());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(instant_issue, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", {
+      make_grade("1.0000 HOBL", 1, 1),
+      make_grade("0.0001 HOBL", 0)
+   }, EA("100.0000 HOBL@conr2d"), expiration, 1, 3600, true));
+
+   auto dseed = fc::sha256::hash(string("dseed"));
+   auto oseed = fc::sha256::hash(string("oseed"));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("instant scheme requires seeds"), issue(N(eun2ce), "hobl", make_dseedhash(dseed), 1));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("hash mismatch"), issue_instant(N(eun2ce), "hobl", oseed, oseed, 1));
+
+   BOOST_REQUIRE_EQUAL(success(), issue_instant(N(eun2ce), "hobl", dseed, oseed, 1, 20));
+   BOOST_REQUIRE(get_pending(1).is_null());
+   BOOST_REQUIRE(get_gacha(1).is_null());
+
+   // limit and budget are accounted as same as commit and reveal
+   BOOST_REQUIRE_EQUAL(1, get_grade(N(conr2d), "hobl", 1)["out_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(19, get_grade(N(conr2d), "hobl", 0)["out_count"].as_uint64());
+
+   auto stat = get_schemestat(N(conr2d), "hobl");
+   BOOST_REQUIRE_EQUAL(20, stat["issued"].as_uint64());
+   BOOST_REQUIRE_EQUAL(0, stat["unresolved"].as_uint64());
+   BOOST_REQUIRE_EQUAL("1.0019 HOBL", stat["out"].as_string());
+   BOOST_REQUIRE_EQUAL("1.0019 HOBL@conr2d", get_reward(N(eun2ce), "HOBL@conr2d")["balance"].as_string());
+
+   // an id is drawn once per scheme contract, even with other seeds, in whatever order ids come
+   auto oseed2 = fc::sha256::hash(string("oseed2"));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("existing gacha"), issue_instant(N(eun2ce), "hobl", dseed, oseed2, 1));
+   BOOST_REQUIRE_EQUAL(success(), issue_instant(N(eun2ce), "hobl", dseed, oseed2, 100));
+   BOOST_REQUIRE_EQUAL(success(), issue_instant(N(eun2ce), "hobl", dseed, oseed, 36));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("existing gacha"), issue_instant(N(eun2ce), "hobl", dseed, oseed2, 36));
+   BOOST_REQUIRE_EQUAL(22, get_schemestat(N(conr2d), "hobl")["issued"].as_uint64());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resolve_within_budget, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", {
+      make_grade("1.0000 HOBL", 1),
+      make_grade("0.1000 HOBL", 0)
+   }, EA("2.5000 HOBL@conr2d"), expiration, 1, 1));
+
+   auto dseed = fc::sha256::hash(string("dseed"));
+   BOOST_REQUIRE_EQUAL(success(), issue(N(eun2ce), "hobl", make_dseedhash(dseed), 1, 10));
+   BOOST_REQUIRE_EQUAL(success(), issue(N(ian), "hobl", make_dseedhash(dseed), 2));
+   BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), 1, fc::sha256::hash(string("oseed"))));
+   produce_block(fc::seconds(1));
+   BOOST_REQUIRE_EQUAL(success(), setoseed(N(ian), 2, fc::sha256::hash(string("oseed"))));
+
+   // only the dealer draws before deadline
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no expired gacha"), resolve(N(ian), 10));
+   BOOST_REQUIRE(!get_gacha(1).is_null());
+
+   // drawn scores keep their grade, so a draw the budget can't pay aborts rather than falling back
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("budget exceeded"), setdseed(1, dseed));
+   BOOST_REQUIRE(!get_gacha(1).is_null());
+   produce_block(fc::seconds(3));
+
+   // without dseed, pulls take the highest grade the rest of budget can pay, then raincheck
+   BOOST_REQUIRE_EQUAL(success(), resolve(N(ian), 10));
+   BOOST_REQUIRE(get_gacha(1).is_null());
+   BOOST_REQUIRE(get_gacha(2).is_null());
+   BOOST_REQUIRE_EQUAL(2, get_grade(N(conr2d), "hobl", 1)["out_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(5, get_grade(N(conr2d), "hobl", 0)["out_count"].as_uint64());
+
+   auto stat = get_schemestat(N(conr2d), "hobl");
+   BOOST_REQUIRE_EQUAL("2.5000 HOBL", stat["out"].as_string());
+   BOOST_REQUIRE_EQUAL(0, stat["unresolved"].as_uint64());
+   BOOST_REQUIRE_EQUAL("2.5000 HOBL@conr2d", get_reward(N(eun2ce), "HOBL@conr2d")["balance"].as_string());
+   BOOST_REQUIRE_EQUAL("0.0000 HOBL@conr2d", get_reward(N(ian), "HOBL@conr2d")["balance"].as_string());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(migrate_legacy_scheme, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+
+   // scheme opened before configuration and counters were split, with its budget held by gacha
+   BOOST_REQUIRE_EQUAL(success(), transfer(N(conr2d), gacha_account_name, EA("10.0000 HOBL@conr2d"), ""));
+   set_table_row(gacha_account_name, N(conr2d), N(scheme), name("hobl").value, "legacy_scheme", mvo()
+      ("scheme_name", "hobl")
+      ("grades", vector<fc::variant>{ make_grade("1.0000 HOBL", 192, 2), make_grade("0.1000 HOBL", 0) })
+      ("budget", EA("10.0000 HOBL@conr2d"))
+      ("expiration", expiration)
+      ("precision", 1)
+      ("deadline_sec", 3600)
+      ("out", "1.1000 HOBL")
+      ("out_count", vector<uint32_t>{1, 1})
+      ("issued", 2)
+      ("unresolved", 0)
+   );
+   produce_block();
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("existing scheme name"), open("hobl", make_grades(1), EA("1.0000 HOBL@conr2d"), expiration, 1, 3600));
+   BOOST_REQUIRE_EQUAL(success(), migrate(N(ian), "hobl"));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("scheme not found"), migrate(N(ian), "hobl"));
+
+   REQUIRE_MATCHING_OBJECT(get_scheme(N(conr2d), "hobl"), mvo()
+      ("scheme_name", "hobl")
+      ("budget", "10.0000 HOBL@conr2d")
+      ("expiration", expiration)
+      ("precision", 1)
+      ("deadline_sec", 3600)
+      ("instant", false)
+   );
+   REQUIRE_MATCHING_OBJECT(get_schemestat(N(conr2d), "hobl"), mvo()
+      ("scheme_name", "hobl")
+      ("out", "1.1000 HOBL")
+      ("issued", 2)
+      ("unresolved", 0)
+   );
+   BOOST_REQUIRE_EQUAL(1, get_grade(N(conr2d), "hobl", 192)["out_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(2, get_grade(N(conr2d), "hobl", 192)["limit"].as_uint64());
+   BOOST_REQUIRE_EQUAL(1, get_grade(N(conr2d), "hobl", 0)["out_count"].as_uint64());
+
+   // the rest of budget is no longer stuck
+   auto balance = get_balance(N(conr2d), "HOBL@conr2d");
+   produce_block(fc::days(1) + fc::seconds(1));
+   BOOST_REQUIRE_EQUAL(success(), close("hobl"));
+   BOOST_REQUIRE_EQUAL(89000, get_balance(N(conr2d), "HOBL@conr2d") - balance);
+   BOOST_REQUIRE(get_scheme(N(conr2d), "hobl").is_null());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(migrate_legacy_gacha, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   auto deadline = time_point_sec(control->head_block_time() + fc::seconds(10));
+   auto dseed = fc::sha256::hash(string("dseed"));
+   auto oseed = fc::sha256::hash(string("oseed"));
+
+   // gacha issued and opened before pending and opened were split, all in the scope of gacha contract
+   BOOST_REQUIRE_EQUAL(success(), transfer(N(conr2d), gacha_account_name, EA("10.0000 HOBL@conr2d"), ""));
+   set_table_row(gacha_account_name, N(conr2d), N(scheme), name("hobl").value, "legacy_scheme", mvo()
+      ("scheme_name", "hobl")
+      ("grades", vector<fc::variant>{ make_grade("1.0000 HOBL", 0) })
+      ("budget", EA("10.0000 HOBL@conr2d"))
+      ("expiration", expiration)
+      ("precision", 1)
+      ("deadline_sec", 3600)
+      ("out", "0.0000 HOBL")
+      ("out_count", vector<uint32_t>{0})
+      ("issued", 2)
+      ("unresolved", 1)
+   );
+   set_table_row(gacha_account_name, gacha_account_name, N(gacha), 1, "legacy_gacha", mvo()
+      ("id", 1)
+      ("owner", "eun2ce")
+      ("scheme", to_variant("hobl", N(conr2d)))
+      ("dseedhash", make_dseedhash(dseed))
+      ("oseed", fc::sha256())
+      ("deadline", time_point_sec::maximum())
+   );
+   set_table_row(gacha_account_name, gacha_account_name, N(gacha), 2, "legacy_gacha", mvo()
+      ("id", 2)
+      ("owner", "ian")
+      ("scheme", to_variant("hobl", N(conr2d)))
+      ("dseedhash", make_dseedhash(dseed))
+      ("oseed", oseed)
+      ("deadline", deadline)
+   );
+   produce_block();
+
+   // scheme is migrated together with the first of its gacha
+   BOOST_REQUIRE_EQUAL(success(), migrategacha(N(ian), 1));
+   BOOST_REQUIRE(!get_scheme(N(conr2d), "hobl").is_null());
+   BOOST_REQUIRE(!get_pending(1).is_null());
+   BOOST_REQUIRE(get_gacha(2).is_null());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("existing gacha"), issue(N(eun2ce), "hobl", make_dseedhash(dseed), 2));
+
+   BOOST_REQUIRE_EQUAL(success(), migrategacha(N(ian), 10));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no gacha to migrate"), migrategacha(N(ian), 10));
+   BOOST_REQUIRE_EQUAL(oseed.str(), get_gacha(2)["oseed"].as_string());
+   BOOST_REQUIRE_EQUAL(get_gacha(2)["deadline"].as_string(), get_due(2)["deadline"].as_string());
+
+   // both can be drawn as if they were issued after split
+   BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), 1, oseed));
+   BOOST_REQUIRE_EQUAL(success(), setdseed(1, dseed));
+   produce_block(fc::seconds(10));
+   BOOST_REQUIRE_EQUAL(success(), resolve(N(ian), 10));
+   BOOST_REQUIRE(get_gacha(2).is_null());
+
+   auto stat = get_schemestat(N(conr2d), "hobl");
+   BOOST_REQUIRE_EQUAL("2.0000 HOBL", stat["out"].as_string());
+   BOOST_REQUIRE_EQUAL(0, stat["unresolved"].as_uint64());
+} FC_LOG_AND_RETHROW()
+
+// Replays draws with the host verifier, which must agree with drawresult traces.
+BOOST_FIXTURE_TEST_CASE(draw_matches_host_verifier, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", {
+      make_grade("1.0000 HOBL", 192, 2),
+      make_grade("0.0100 HOBL", 64),
+      make_grade("0.0001 HOBL", 16)
+   }, EA("100.0000 HOBL@conr2d"), expiration, 1, 1));
+
+   gxc::gacha_verify::scheme s;
+   s.precision = 1;
+   s.budget = 1000000;
+   s.grades = {{192, 10000, 2}, {64, 100, {}}, {16, 1, {}}};
+
+   vector<gxc::gacha_verify::ticket> tickets(2);
+   auto dseed = fc::sha256::hash(string("dseed"));
+   auto oseed = fc::sha256::hash(string("oseed"));
+   for (uint64_t id = 1; id <= 2; ++id) {
+      BOOST_REQUIRE_EQUAL(success(), issue(N(eun2ce), "hobl", make_dseedhash(dseed), id, 20));
+      BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), id, oseed));
+
+      auto& t = tickets[id-1];
+      t.id = id;
+      t.pulls = 20;
+      t.dseed = to_checksum(dseed);
+      t.oseed = to_checksum(oseed);
+   }
+   produce_blocks(1);
+
+   // the first is revealed, the second is resolved after deadline
+   vector<transaction_trace_ptr> traces;
+   traces.emplace_back(push_trx(gacha_account_name, N(setdseed), N(conr2d), mvo()("contract", N(conr2d))("id", 1)("dseed", dseed)));
+   produce_block(fc::seconds(2));
+   traces.emplace_back(push_trx(gacha_account_name, N(resolve), N(ian), mvo()("max_items", 1)));
+   tickets[1].expired = true;
+
+   for (size_t i = 0; i < traces.size(); ++i) {
+      for (const auto& at: traces[i]->action_traces) {
+         if (at.receiver != gacha_account_name || at.act.name != N(drawresult)) continue;
+         auto data = abi_ser[gacha_account_name].binary_to_variant("drawresult", at.act.data, abi_serializer_max_time);
+         for (const auto& r: data["results"].get_array()) tickets[i].recorded.push_back(r["score"].as_int64());
+      }
+      BOOST_REQUIRE_EQUAL(tickets[i].pulls, tickets[i].recorded.size());
+   }
+
+   vector<size_t> offsets;
+   vector<int64_t> scores;
+   gxc::gacha_verify::draw_all(tickets, s.precision, 2, offsets, scores);
+
+   gxc::gacha_verify::grader g(s);
+   for (size_t i = 0; i < tickets.size(); ++i) {
+      for (uint16_t pull = 0; pull < tickets[i].pulls; ++pull) {
+         BOOST_REQUIRE_EQUAL(tickets[i].recorded[pull], scores[offsets[i] + pull]);
+         g.draw(scores[offsets[i] + pull]);
+      }
+   }
+
+   for (size_t i = 0; i < s.grades.size(); ++i) {
+      BOOST_REQUIRE_EQUAL(g.grades()[i].out_count, get_grade(N(conr2d), "hobl", s.grades[i].score)["out_count"].as_uint64());
+   }
+   BOOST_REQUIRE_EQUAL(g.out(), asset::from_string(get_schemestat(N(conr2d), "hobl")["out"].as_string()).get_amount());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(trace_dump_matches_host_verifier, gxc_gacha_tester) try {
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   vector<fc::variant> grades = {
+      make_grade("1.0000 HOBL", 192, 2),
+      make_grade("0.0100 HOBL", 64),
+      make_grade("0.0001 HOBL", 16)
+   };
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", grades, EA("100.0000 HOBL@conr2d"), expiration, 1, 1));
+   BOOST_REQUIRE_EQUAL(success(), open("inst", grades, EA("100.0000 HOBL@conr2d"), expiration, 1, 1, true));
+
+   // both schemes as gacha-verify reads
+   std::istringstream scheme_json(fc::json::to_string(mvo()
+      ("precision", 1)
+      ("budget", 1000000)
+      ("grades", vector<fc::variant>{
+         mvo()("score", 192)("reward", 10000)("limit", 2),
+         mvo()("score", 64)("reward", 100),
+         mvo()("score", 16)("reward", 1)
+      })
+   ));
+   auto s = gxc::gacha_verify::read_scheme(scheme_json);
+
+   // a line of trace dump with scores of drawresult in `trace`
+   auto dump = [&](const transaction_trace_ptr& trace, mvo ticket) {
+      vector<fc::variant> scores;
+      for (const auto& at: trace->action_traces) {
+         if (at.receiver != gacha_account_name || at.act.name != N(drawresult)) continue;
+         auto data = abi_ser[gacha_account_name].binary_to_variant("drawresult", at.act.data, abi_serializer_max_time);
+         for (const auto& r: data["results"].get_array()) scores.emplace_back(std::to_string(r["score"].as_int64()));
+      }
+      return fc::json::to_string(ticket("scores", scores));
+   };
+
+   auto dseed = fc::sha256::hash(string("dseed"));
+   auto oseed = fc::sha256::hash(string("oseed"));
+   for (uint64_t id = 1; id <= 2; ++id) {
+      BOOST_REQUIRE_EQUAL(success(), issue(N(eun2ce), "hobl", make_dseedhash(dseed), id, 20));
+      BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), id, oseed));
+   }
+   produce_blocks(1);
+
+   // the first is revealed, the second is resolved after deadline
+   vector<string> lines;
+   auto trace = push_trx(gacha_account_name, N(setdseed), N(conr2d), mvo()("contract", N(conr2d))("id", 1)("dseed", dseed));
+   lines.push_back(dump(trace, mvo()("id", 1)("pulls", 20)("dseed", dseed)("oseed", oseed)));
+   produce_block(fc::seconds(2));
+   trace = push_trx(gacha_account_name, N(resolve), N(ian), mvo()("max_items", 1));
+   lines.push_back(dump(trace, mvo()("id", 2)("pulls", 20)("oseed", oseed)));
+
+   // instant draw is seeded by blocks before the one including it
+   trace = push_issue_instant(N(eun2ce), "inst", dseed, oseed, 3, 20);
+   vector<string> block_ids;
+   for (uint32_t age = 0; age < gxc::gacha_math::instant_blocks; ++age) {
+      block_ids.push_back(control->fetch_block_by_number(control->head_block_num() - 1 - age)->id().str());
+   }
+   auto instant_line = dump(trace, mvo()("id", 3)("pulls", 20)("dseed", dseed)("oseed", oseed)("block_ids", block_ids));
+
+   auto verify = [&](const string& scheme_name, const vector<string>& lines) {
+      vector<gxc::gacha_verify::ticket> tickets;
+      for (const auto& line: lines) {
+         tickets.push_back(gxc::gacha_verify::parse_ticket(line));
+         BOOST_REQUIRE_EQUAL(tickets.back().pulls, tickets.back().recorded.size());
+      }
+
+      vector<size_t> offsets;
+      vector<int64_t> scores;
+      gxc::gacha_verify::draw_all(tickets, s.precision, 2, offsets, scores);
+
+      gxc::gacha_verify::grader g(s);
+      for (size_t i = 0; i < tickets.size(); ++i) {
+         for (uint16_t pull = 0; pull < tickets[i].pulls; ++pull) {
+            BOOST_REQUIRE_EQUAL(tickets[i].recorded[pull], scores[offsets[i] + pull]);
+            g.draw(scores[offsets[i] + pull]);
+         }
+      }
+      BOOST_REQUIRE_EQUAL(g.out(), asset::from_string(get_schemestat(N(conr2d), scheme_name)["out"].as_string()).get_amount());
+   };
+   verify("hobl", lines);
+   verify("inst", {instant_line});
+} FC_LOG_AND_RETHROW()
+
+// Reports billed cpu of setdseed by the number of grades. Runs only with GXC_BENCHMARK set.
+BOOST_FIXTURE_TEST_CASE(draw_cpu_by_grades, gxc_gacha_tester, BENCHMARK) try {
+   const uint32_t draws = 20;
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+
+   std::cout << "gacha draw: " << draws << " draws per scheme" << std::endl;
+   std::cout << "   grades   avg cpu(us)   max cpu(us)" << std::endl;
+
+   uint64_t id = 0;
+   for (uint32_t count: {5, 50, 500}) {
+      auto scheme_name = "grade" + std::to_string(count);
+      BOOST_REQUIRE_EQUAL(success(), open(scheme_name, make_grades(count), EA("1000.0000 HOBL@conr2d"), expiration, 4, 3600));
+      produce_blocks(1);
+
+      vector<pair<uint64_t, fc::sha256>> tickets;
+      for (uint32_t i = 0; i < draws; ++i) {
+         auto dseed = fc::sha256::hash(scheme_name + std::to_string(i));
+         BOOST_REQUIRE_EQUAL(success(), issue(N(eun2ce), scheme_name, make_dseedhash(dseed), ++id));
+         BOOST_REQUIRE_EQUAL(success(), setoseed(N(eun2ce), id, fc::sha256::hash(std::to_string(id))));
+         tickets.emplace_back(id, dseed);
+      }
+      produce_blocks(1);
+
+      uint64_t cpu_total = 0;
+      uint32_t cpu_max = 0;
+      for (const auto& t: tickets) {
+         auto trace = push_trx(gacha_account_name, N(setdseed), N(conr2d), mvo()("contract", N(conr2d))("id", t.first)("dseed", t.second));
+         cpu_total += trace->receipt->cpu_usage_us;
+         cpu_max = std::max(cpu_max, trace->receipt->cpu_usage_us);
+      }
+      produce_blocks(1);
+
+      std::cout << std::setw(9) << count << std::setw(14) << cpu_total / draws << std::setw(14) << cpu_max << std::endl;
+      BOOST_REQUIRE_EQUAL(0, get_schemestat(N(conr2d), scheme_name)["unresolved"].as_uint64());
+   }
+} FC_LOG_AND_RETHROW()
+
+// Fills expired gacha and drains them by bounded resolve calls, reporting billed cpu per call.
+// Runs only with GXC_BENCHMARK set, and GACHA_RESOLVE_TICKETS changes the number of gacha.
+BOOST_FIXTURE_TEST_CASE(resolve_expired_backlog, gxc_gacha_tester, BENCHMARK) try {
+   const uint32_t per_batch = 500, per_trx = 100, max_items = 100;
+   const auto total = resolve_tickets();
+
+   auto expiration = time_point_sec(control->head_block_time() + fc::days(1));
+   BOOST_REQUIRE_EQUAL(success(), open("hobl", make_grades(5), EA("10000.0000 HOBL@conr2d"), expiration, 4, 1));
+
+   uint64_t id = 0;
+   while (id < total) {
+      vector<fc::variant> tickets;
+      for (uint32_t i = 0; i < per_batch && id + tickets.size() < total; ++i) {
+         tickets.emplace_back(mvo()("to", N(eun2ce))("id", id + i + 1)("pulls", fc::variant()));
+      }
+      BOOST_REQUIRE_EQUAL(success(), issuebatch("hobl", fc::sha256::hash(std::to_string(id)), tickets));
+
+      for (uint32_t i = 0; i < tickets.size(); i += per_trx) {
+         signed_transaction trx;
+         for (uint32_t j = i; j < std::min<uint32_t>(i + per_trx, tickets.size()); ++j) {
+            trx.actions.emplace_back(get_action(gacha_account_name, N(setoseed), vector<permission_level>{{N(eun2ce), config::active_name}}, mvo()
+               ("contract", N(conr2d))
+               ("id", id + j + 1)
+               ("oseed", fc::sha256::hash(std::to_string(id + j + 1)))
+            ));
+         }
+         set_transaction_headers(trx);
+         trx.sign(get_private_key(N(eun2ce), "active"), control->get_chain_id());
+         push_transaction(trx);
+      }
+      id += tickets.size();
+      produce_blocks(1);
+   }
+   BOOST_REQUIRE_EQUAL(total, get_schemestat(N(conr2d), "hobl")["unresolved"].as_uint64());
+
+   produce_block(fc::seconds(2));
+
+   uint64_t calls = 0, cpu_total = 0;
+   uint32_t cpu_max = 0;
+   while (get_schemestat(N(conr2d), "hobl")["unresolved"].as_uint64() > 0) {
+      // anyone can resolve expired gacha
+      auto trace = push_trx(gacha_account_name, N(resolve), N(ian), mvo()("max_items", max_items));
+      calls++;
+      cpu_total += trace->receipt->cpu_usage_us;
+      cpu_max = std::max(cpu_max, trace->receipt->cpu_usage_us);
+      if (calls % 10 == 0) produce_blocks(1);
+   }
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no expired gacha"), resolve(N(ian), max_items));
+
+   std::cout << "gacha resolve: " << total << " expired gacha, " << max_items << " per call" << std::endl;
+   std::cout << "   calls " << calls << ", avg cpu(us) " << (calls ? cpu_total / calls : 0)
+             << ", max cpu(us) " << cpu_max << ", cpu(us) per gacha " << (total ? double(cpu_total) / total : 0) << std::endl;
+   BOOST_REQUIRE_EQUAL((total + max_items - 1) / max_items, calls);
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,5 +1,8 @@
 #include "token_tester.hpp"
 
+#include <iomanip>
+#include <set>
+
 const static name htlc_account_name = N(gxc.htlc);
 const static name vault_account_name = N(gxc.vault);
 
@@ -26,6 +29,12 @@ public:
          ("requirement", name("token"))
       );
 
+      // htlc pulls locked value and refunds it on its own
+      set_authority(htlc_account_name, config::active_name,
+         authority(1, {key_weight{get_public_key(htlc_account_name, "active"), 1}}, {permission_level_weight{{htlc_account_name, config::eosio_code_name}, 1}}),
+         config::owner_name, {{htlc_account_name, config::owner_name}}, {get_private_key(htlc_account_name, "owner")}
+      );
+
       auto accnt = control->db().get<account_object,by_name>(htlc_account_name);
       abi_def abi;
       BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
@@ -40,16 +49,71 @@ public:
       return data.empty() ? fc::variant() : abi_ser[htlc_account_name].binary_to_variant("lock_contract", data, abi_serializer_max_time);
    }
 
-   action_result newcontract(account_name owner, const string& contract_name, std::array<string,2> recipient, extended_asset value, const string& hashlock, const string& timelock) {
-      return PUSH_ACTION(htlc_account_name, owner, (owner)(contract_name)(recipient)(value)(hashlock)(timelock));
+   fc::variant get_htlc(const account_name& owner, uint64_t id) {
+      vector<char> data = get_row_by_account(htlc_account_name, owner, N(htlcid), id);
+      return data.empty() ? fc::variant() : abi_ser[htlc_account_name].binary_to_variant("id_contract", data, abi_serializer_max_time);
+   }
+
+   // trailing id is a binary extension, so it's left out rather than null when not given
+   static mvo with_id(mvo data, const optional<uint64_t>& id) {
+      if (id) data("id", *id);
+      return data;
+   }
+
+   action_result newcontract(account_name owner, const string& contract_name, std::array<string,2> recipient, extended_asset value, const string& hashlock, const string& timelock, optional<uint64_t> id = {}) {
+      return push_action(htlc_account_name, N(newcontract), owner, with_id(mvo()
+         ("owner", owner)
+         ("contract_name", contract_name)
+         ("recipient", recipient)
+         ("value", value)
+         ("hashlock", hashlock)
+         ("timelock", timelock)
+      , id));
+   }
+
+   action_result newcontracts(account_name owner, const vector<fc::variant>& items) {
+      return PUSH_ACTION(htlc_account_name, owner, (owner)(items));
+   }
+
+   action_result withdraw(account_name owner, const string& contract_name, const fc::sha256& preimage, optional<uint64_t> id = {}) {
+      return push_action(htlc_account_name, N(withdraw), owner, with_id(mvo()
+         ("owner", owner)
+         ("contract_name", contract_name)
+         ("preimage", preimage)
+      , id));
+   }
+
+   action_result withdrawall(account_name actor, const fc::sha256& preimage, uint32_t max_items) {
+      return PUSH_ACTION(htlc_account_name, actor, (preimage)(max_items));
+   }
+
+   // memos of transfers pushed by `trace`
+   vector<string> get_transfer_memos(const transaction_trace_ptr& trace) {
+      vector<string> memos;
+      for (const auto& at: trace->action_traces) {
+         if (at.receiver != token_account_name || at.act.name != N(transfer)) continue;
+         auto data = abi_ser[token_account_name].binary_to_variant(abi_ser[token_account_name].get_action_type(N(transfer)), at.act.data, abi_serializer_max_time);
+         memos.emplace_back(data["memo"].as_string());
+      }
+      return memos;
+   }
+
+   action_result refund(account_name owner, const string& contract_name, optional<uint64_t> id = {}) {
+      return push_action(htlc_account_name, N(refund), owner, with_id(mvo()
+         ("owner", owner)
+         ("contract_name", contract_name)
+      , id));
    }
 
-   action_result withdraw(account_name owner, const string& contract_name, key256_t preimage) {
-      return PUSH_ACTION(htlc_account_name, owner, (owner)(contract_name)(preimage));
+   fc::variant get_expiry(const account_name& owner, const string& contract_name) {
+      auto id = XXH64(contract_name.data(), contract_name.size(), 0);
+      return find_table_row(htlc_account_name, htlc_account_name, N(expiry), "", [&](const fc::variant& e) {
+         return e["owner"].as<account_name>() == owner && e["id"].as_uint64() == id;
+      });
    }
 
-   action_result refund(account_name owner, const string& contract_name) {
-      return PUSH_ACTION(htlc_account_name, owner, (owner)(contract_name));
+   action_result refundexpired(account_name actor, uint32_t max_items) {
+      return PUSH_ACTION(htlc_account_name, actor, (max_items));
    }
 
    action_result setconfig(extended_asset min_amount, uint32_t min_duration) {
@@ -78,16 +142,237 @@ BOOST_FIXTURE_TEST_CASE(newcontract_tests, gxc_htlc_tester) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(newcontracts_tests, gxc_htlc_tester) try {
+   std::array<string,2> recipient = {"checksum160", "30aad1038d0e503e85c3d4b5b5c7130f548a5e82"};
+   string hashlock = "0b671e154e4bff76508922c6e68a3b331a00dcd94e7e97ada243735df42c5360";
+   auto timelock = time_point_sec(control->head_block_time() + fc::days(1)).to_iso_string();
+
+   transfer(config::null_account_name, N(conr2d), EA("100.0000 GXC@gxc"), "");
+   approve(N(conr2d), htlc_account_name, EA("100.0000 GXC@gxc"));
+
+   auto make_item = [&](const string& contract_name, const string& value) {
+      return fc::variant(mvo()
+         ("contract_name", contract_name)
+         ("recipient", recipient)
+         ("value", value)
+         ("hashlock", hashlock)
+         ("timelock", timelock)
+         ("id", fc::variant())
+      );
+   };
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no contract to create"), newcontracts(N(conr2d), {}));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("existing contract name"), newcontracts(N(conr2d), {
+      make_item("a", "1.0000 GXC@gxc"),
+      make_item("a", "2.0000 GXC@gxc")
+   }));
+
+   auto balance = get_balance(N(conr2d), "GXC@gxc");
+   BOOST_REQUIRE_EQUAL(success(), newcontracts(N(conr2d), {
+      make_item("a", "1.0000 GXC@gxc"),
+      make_item("b", "2.0000 GXC@gxc"),
+      make_item("c", "4.0000 GXC@gxc")
+   }));
+   BOOST_REQUIRE_EQUAL(70000, balance - get_balance(N(conr2d), "GXC@gxc"));
+   BOOST_REQUIRE_EQUAL("2.0000 GXC@gxc", get_htlc(N(conr2d), "b")["value"].as_string());
+   BOOST_REQUIRE(!get_expiry(N(conr2d), "c").is_null());
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("existing contract name"), newcontracts(N(conr2d), { make_item("c", "1.0000 GXC@gxc") }));
+
+   // summed value to pull can't wrap around
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("addition overflow"), newcontracts(N(conr2d), {
+      make_item("d", "461168601842738.7903 GXC@gxc"),
+      make_item("e", "0.0001 GXC@gxc")
+   }));
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(withdraw_tests, gxc_htlc_tester) try {
    BOOST_TEST_MESSAGE("not implemented yet");
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(withdrawall_tests, gxc_htlc_tester) try {
+   auto preimage = fc::sha256::hash(string("preimage"));
+   auto hashlock = fc::sha256::hash(preimage.data(), preimage.data_size()).str();
+   auto other = fc::sha256::hash(string("other")).str();
+   std::array<string,2> recipient = {"checksum160", "30aad1038d0e503e85c3d4b5b5c7130f548a5e82"};
+   auto timelock = time_point_sec(control->head_block_time() + fc::days(1)).to_iso_string();
+
+   transfer(config::null_account_name, N(ian), EA("100.0000 GXC@gxc"), "");
+   approve(N(ian), htlc_account_name, EA("100.0000 GXC@gxc"));
+
+   // expired by the time of withdrawall, and visited first among contracts of the hashlock
+   auto expiring = time_point_sec(control->head_block_time() + fc::seconds(2)).to_iso_string();
+   BOOST_REQUIRE_EQUAL(success(), newcontract(N(ian), "x", recipient, EA("32.0000 GXC@gxc"), hashlock, expiring));
+
+   BOOST_REQUIRE_EQUAL(success(), newcontract(vault_account_name, "a", {"name", "conr2d"}, EA("1.0000 GXC@gxc"), hashlock, timelock));
+   BOOST_REQUIRE_EQUAL(success(), newcontract(vault_account_name, "b", {"name", "eun2ce"}, EA("2.0000 GXC@gxc"), hashlock, timelock));
+   BOOST_REQUIRE_EQUAL(success(), newcontract(vault_account_name, "c", {"name", "conr2d"}, EA("4.0000 GXC@gxc"), hashlock, timelock));
+   BOOST_REQUIRE_EQUAL(success(), newcontract(N(ian), "a", recipient, EA("8.0000 GXC@gxc"), hashlock, timelock));
+   BOOST_REQUIRE_EQUAL(success(), newcontract(N(ian), "b", recipient, EA("16.0000 GXC@gxc"), other, timelock));
+   produce_block(fc::seconds(3));
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("max_items should be positive"), withdrawall(N(eun2ce), preimage, 0));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no contract to withdraw"), withdrawall(N(eun2ce), fc::sha256::hash(string("wrong")), 10));
+
+   auto conr2d_balance = get_balance(N(conr2d), "GXC@gxc");
+   auto eun2ce_balance = get_balance(N(eun2ce), "GXC@gxc");
+   auto htlc_balance = get_balance(htlc_account_name, "GXC@gxc");
+
+   // max_items counts the expired contract too, so a call settles one less than it visits
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no contract to withdraw"), withdrawall(N(eun2ce), preimage, 1));
+
+   // settled over two calls by max_items, each contract by its own transfer
+   std::set<string> memos;
+   for (uint32_t max_items: { 3, 10 }) {
+      auto trace = push_trx(htlc_account_name, N(withdrawall), N(eun2ce), mvo()("preimage", preimage)("max_items", max_items));
+      auto m = get_transfer_memos(trace);
+      BOOST_REQUIRE_EQUAL(2, m.size());
+      memos.insert(m.begin(), m.end());
+   }
+   BOOST_REQUIRE(memos == std::set<string>({
+      "htlc processed from gxc.vault: a",
+      "htlc processed from gxc.vault: b",
+      "htlc processed from gxc.vault: c",
+      "htlc processed from ian: a"
+   }));
+   BOOST_REQUIRE_EQUAL(50000, get_balance(N(conr2d), "GXC@gxc") - conr2d_balance);
+   BOOST_REQUIRE_EQUAL(20000, get_balance(N(eun2ce), "GXC@gxc") - eun2ce_balance);
+   BOOST_REQUIRE_EQUAL(80000, htlc_balance - get_balance(htlc_account_name, "GXC@gxc"));
+
+   for (auto n: { "a", "b", "c" }) BOOST_REQUIRE(get_htlc(vault_account_name, n).is_null());
+   BOOST_REQUIRE(get_htlc(N(ian), "a").is_null());
+   BOOST_REQUIRE(get_expiry(N(ian), "a").is_null());
+   BOOST_REQUIRE(!get_htlc(N(ian), "b").is_null());
+   BOOST_REQUIRE(!get_htlc(N(ian), "x").is_null());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no contract to withdraw"), withdrawall(N(eun2ce), preimage, 10));
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(refund_tests, gxc_htlc_tester) try {
    BOOST_TEST_MESSAGE("not implemented yet");
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(refundexpired_tests, gxc_htlc_tester) try {
+   std::array<string,2> recipient = {"checksum160", "30aad1038d0e503e85c3d4b5b5c7130f548a5e82"};
+   string hashlock = "0b671e154e4bff76508922c6e68a3b331a00dcd94e7e97ada243735df42c5360";
+   auto soon = time_point_sec(control->head_block_time() + fc::seconds(10)).to_iso_string();
+   auto later = time_point_sec(control->head_block_time() + fc::days(1)).to_iso_string();
+
+   for (auto owner: { N(conr2d), N(eun2ce) }) {
+      transfer(config::null_account_name, owner, EA("100.0000 GXC@gxc"), "");
+      approve(owner, htlc_account_name, EA("100.0000 GXC@gxc"));
+   }
+   BOOST_REQUIRE_EQUAL(success(), newcontract(N(conr2d), "a", recipient, EA("1.0000 GXC@gxc"), hashlock, soon));
+   BOOST_REQUIRE_EQUAL(success(), newcontract(N(conr2d), "b", recipient, EA("2.0000 GXC@gxc"), hashlock, soon));
+   BOOST_REQUIRE_EQUAL(success(), newcontract(N(conr2d), "c", recipient, EA("4.0000 GXC@gxc"), hashlock, later));
+   BOOST_REQUIRE_EQUAL(success(), newcontract(N(eun2ce), "a", recipient, EA("8.0000 GXC@gxc"), hashlock, soon));
+   BOOST_REQUIRE_EQUAL(get_htlc(N(conr2d), "a")["timelock"].as_string(), get_expiry(N(conr2d), "a")["timelock"].as_string());
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no expired contract"), refundexpired(N(ian), 10));
+   produce_block(fc::seconds(20));
+
+   // anyone can refund expired contracts
+   auto conr2d_balance = get_balance(N(conr2d), "GXC@gxc");
+   auto eun2ce_balance = get_balance(N(eun2ce), "GXC@gxc");
+   BOOST_REQUIRE_EQUAL(success(), refundexpired(N(ian), 10));
+   BOOST_REQUIRE_EQUAL(30000, get_balance(N(conr2d), "GXC@gxc") - conr2d_balance);
+   BOOST_REQUIRE_EQUAL(80000, get_balance(N(eun2ce), "GXC@gxc") - eun2ce_balance);
+
+   BOOST_REQUIRE(get_htlc(N(conr2d), "a").is_null());
+   BOOST_REQUIRE(get_expiry(N(conr2d), "a").is_null());
+   BOOST_REQUIRE(get_htlc(N(eun2ce), "a").is_null());
+   BOOST_REQUIRE(!get_htlc(N(conr2d), "c").is_null());
+   BOOST_REQUIRE(!get_expiry(N(conr2d), "c").is_null());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no expired contract"), refundexpired(N(ian), 10));
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(setconfig_tests, gxc_htlc_tester) try {
    BOOST_TEST_MESSAGE("not implemented yet");
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(contract_by_id_tests, gxc_htlc_tester) try {
+   std::array<string,2> recipient = {"checksum160", "30aad1038d0e503e85c3d4b5b5c7130f548a5e82"};
+   auto preimage = fc::sha256::hash(string("preimage"));
+   auto hashlock = fc::sha256::hash(preimage.data(), preimage.data_size()).str();
+   auto timelock = time_point_sec(control->head_block_time() + fc::hours(1)).to_iso_string();
+
+   transfer(config::null_account_name, N(ian), EA("100.0000 GXC@gxc"), "");
+   approve(N(ian), htlc_account_name, EA("100.0000 GXC@gxc"));
+
+   // id replaces contract name
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("contract name should be empty with id"), newcontract(N(ian), "a", recipient, EA("1.0000 GXC@gxc"), hashlock, timelock, 1));
+   BOOST_REQUIRE_EQUAL(success(), newcontract(N(ian), "", recipient, EA("1.0000 GXC@gxc"), hashlock, timelock, 1));
+   BOOST_REQUIRE_EQUAL(success(), newcontract(N(ian), "a", recipient, EA("2.0000 GXC@gxc"), hashlock, timelock));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("existing contract name"), newcontract(N(ian), "", recipient, EA("1.0000 GXC@gxc"), hashlock, timelock, 1));
+   BOOST_REQUIRE_EQUAL("1.0000 GXC@gxc", get_htlc(N(ian), uint64_t(1))["value"].as_string());
+   BOOST_REQUIRE(get_row_by_account(htlc_account_name, N(ian), N(htlc), 1).empty());
+   BOOST_REQUIRE_EQUAL("2.0000 GXC@gxc", get_htlc(N(ian), "a")["value"].as_string());
+
+   BOOST_REQUIRE_EQUAL(success(), withdraw(N(ian), "", preimage, 1));
+   BOOST_REQUIRE(get_htlc(N(ian), uint64_t(1)).is_null());
+   BOOST_REQUIRE(!get_htlc(N(ian), "a").is_null());
+   BOOST_REQUIRE_EQUAL(success(), withdraw(N(ian), "a", preimage));
+   BOOST_REQUIRE(get_htlc(N(ian), "a").is_null());
+} FC_LOG_AND_RETHROW()
+
+// Reports ram per contract and billed cpu of newcontract, withdraw and refund, by contract name and by id.
+BOOST_FIXTURE_TEST_CASE(contract_cost_by_key, gxc_htlc_tester, BENCHMARK) try {
+   const uint32_t count = 20;
+   std::array<string,2> recipient = {"checksum160", "30aad1038d0e503e85c3d4b5b5c7130f548a5e82"};
+   auto preimage = fc::sha256::hash(string("preimage"));
+   auto hashlock = fc::sha256::hash(preimage.data(), preimage.data_size()).str();
+
+   transfer(config::null_account_name, N(ian), EA("1000.0000 GXC@gxc"), "");
+   approve(N(ian), htlc_account_name, EA("1000.0000 GXC@gxc"));
+   produce_blocks(1);
+
+   std::cout << "htlc cost: " << count << " contracts per action" << std::endl;
+   std::cout << "   key    ram(bytes)   create cpu(us)   withdraw cpu(us)   refund cpu(us)" << std::endl;
+
+   for (bool by_id: { false, true }) {
+      auto timelock = time_point_sec(control->head_block_time() + fc::hours(1)).to_iso_string();
+      auto key = [&](uint32_t i) {
+         // names of bridged contracts are usually hex of 32 bytes
+         auto contract_name = by_id ? string() : "0x" + fc::sha256::hash(std::to_string(i)).str();
+         return std::make_pair(contract_name, by_id ? optional<uint64_t>(i + 1) : optional<uint64_t>());
+      };
+
+      auto& rlm = control->get_resource_limits_manager();
+      auto ram = rlm.get_account_ram_usage(N(ian));
+      uint64_t cpu[3] = {};
+      for (uint32_t i = 0; i < 2 * count; ++i) {
+         auto k = key(i);
+         auto trace = push_trx(htlc_account_name, N(newcontract), N(ian), with_id(mvo()
+            ("owner", N(ian))
+            ("contract_name", k.first)
+            ("recipient", recipient)
+            ("value", "1.0000 GXC@gxc")
+            ("hashlock", hashlock)
+            ("timelock", timelock)
+         , k.second));
+         cpu[0] += trace->receipt->cpu_usage_us;
+      }
+      ram = rlm.get_account_ram_usage(N(ian)) - ram;
+      produce_blocks(1);
+
+      for (uint32_t i = 0; i < count; ++i) {
+         auto k = key(i);
+         auto trace = push_trx(htlc_account_name, N(withdraw), N(ian), with_id(mvo()("owner", N(ian))("contract_name", k.first)("preimage", preimage), k.second));
+         cpu[1] += trace->receipt->cpu_usage_us;
+      }
+      produce_block(fc::hours(2));
+
+      for (uint32_t i = count; i < 2 * count; ++i) {
+         auto k = key(i);
+         auto trace = push_trx(htlc_account_name, N(refund), N(ian), with_id(mvo()("owner", N(ian))("contract_name", k.first), k.second));
+         cpu[2] += trace->receipt->cpu_usage_us;
+      }
+      produce_blocks(1);
+
+      std::cout << "   " << std::left << std::setw(4) << (by_id ? "id" : "name") << std::right
+                << std::setw(14) << ram / (2 * count) << std::setw(17) << cpu[0] / (2 * count)
+                << std::setw(19) << cpu[1] / count << std::setw(17) << cpu[2] / count << std::endl;
+      BOOST_REQUIRE(by_id ? get_htlc(N(ian), uint64_t(count + 1)).is_null() : get_htlc(N(ian), key(count).first).is_null());
+   }
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "token_tester.hpp"
+
+const static name account_account_name = N(gxc.account);
+
+class gxc_system_tester : public gxc_token_tester {
+public:
+
+   gxc_system_tester() {
+      create_accounts({ account_account_name });
+      produce_blocks(1);
+
+      _set_code(account_account_name, contracts::account_wasm());
+      _set_abi(account_account_name, contracts::account_abi().data());
+      produce_blocks(1);
+      abi_ser[account_account_name].set_abi(fc::json::from_string(contracts::account_abi().data()).as<abi_def>(), abi_serializer_max_time);
+
+      const auto& accnt = control->db().get<account_object,by_name>(config::system_account_name);
+      abi_def abi;
+      BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
+      abi_ser[config::system_account_name].set_abi(abi, abi_serializer_max_time);
+   }
+
+   fc::variant get_singleton(const account_name& table, const string& type) {
+      return get_table_row(config::system_account_name, config::system_account_name, table, table.value, type);
+   }
+
+   fc::variant get_global() {
+      return get_singleton(N(global), "gxc_global_state");
+   }
+
+   fc::variant get_last_block() {
+      return get_singleton(N(lastblock), "last_block");
+   }
+
+   fc::variant get_recent_block(uint32_t block_num) {
+      return get_table_row(config::system_account_name, config::system_account_name, N(recentblocks), block_num % 256, "recent_block");
+   }
+
+   fc::variant get_userres(const account_name& owner) {
+      return get_table_row(config::system_account_name, owner, N(userres), owner.value, "user_resources");
+   }
+
+   action_result genaccount(account_name creator, account_name name, const string& nickname) {
+      return push_action(config::system_account_name, N(genaccount), creator, mvo()
+         ("creator", creator)
+         ("name", name)
+         ("owner", authority(get_public_key(name, "owner")))
+         ("active", authority(get_public_key(name, "active")))
+         ("nickname", nickname)
+      );
+   }
+
+   fc::variant get_nickname(const account_name& name) {
+      auto row = get_table_row(account_account_name, account_account_name, N(accounts), name.value);
+      return row.is_null() ? row : row["nickname"];
+   }
+
+   static mvo genaccounts_args(account_name creator, const vector<std::pair<account_name, string>>& accounts) {
+      vector<variant> items;
+      for (auto& a: accounts) {
+         items.push_back(mvo()
+            ("account", a.first)
+            ("owner", authority(get_public_key(a.first, "owner")))
+            ("active", authority(get_public_key(a.first, "active")))
+            ("nickname", a.second)
+         );
+      }
+      return mvo()("creator", creator)("accounts", items);
+   }
+
+   action_result genaccounts(account_name creator, const vector<std::pair<account_name, string>>& accounts) {
+      return push_action(config::system_account_name, N(genaccounts), creator, genaccounts_args(creator, accounts));
+   }
+
+   action_result setalimits(account_name account, int64_t ram_bytes, int64_t net_weight, int64_t cpu_weight) {
+      return push_action(config::system_account_name, N(setalimits), config::system_account_name, mvo()
+         ("account", account)
+         ("ram_bytes", ram_bytes)
+         ("net_weight", net_weight)
+         ("cpu_weight", cpu_weight)
+      );
+   }
+
+   action_result setalimitsv(const vector<std::tuple<account_name, int64_t, int64_t, int64_t>>& limits) {
+      vector<variant> items;
+      for (auto& [account, ram, net, cpu]: limits)
+         items.push_back(fc::variants{account, ram, net, cpu});
+      return push_action(config::system_account_name, N(setalimitsv), config::system_account_name, mvo()
+         ("limits", items)
+      );
+   }
+
+   action_result setramgift(uint8_t kbytes) {
+      return push_action(config::system_account_name, N(setramgift), config::system_account_name, mvo()
+         ("kbytes", kbytes)
+      );
+   }
+};
@@ -0,0 +1,185 @@
+#include "system_tester.hpp"
+
+#include <iomanip>
+
+BOOST_AUTO_TEST_SUITE(gxc_system_tests)
+
+BOOST_FIXTURE_TEST_CASE(onblock_keeps_global_state, gxc_system_tester) try {
+   produce_blocks(2);
+
+   // onblock only updates its own singleton
+   BOOST_REQUIRE(get_global().is_null());
+   auto last = get_last_block();
+   BOOST_REQUIRE(!last.is_null());
+
+   produce_blocks(1);
+   BOOST_REQUIRE(last["last_block_num"].as_string() != get_last_block()["last_block_num"].as_string());
+
+   // global state is written once it's modified
+   BOOST_REQUIRE_EQUAL(success(), setramgift(4));
+   BOOST_REQUIRE_EQUAL(4, get_global()["ram_gift_kbytes"].as_uint64());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(init_writes_global_state, gxc_system_tester) try {
+   mint(EA("1000000000.0000 GXC@gxc"));
+   BOOST_REQUIRE(get_global().is_null());
+
+   BOOST_REQUIRE_EQUAL(success(), push_action(config::system_account_name, N(init), config::system_account_name, mvo()
+      ("version", 0)
+      ("core", "4,GXC")
+   ));
+
+   // defaults are stored without any action modifying them
+   auto global = get_global();
+   BOOST_REQUIRE(!global.is_null());
+   BOOST_REQUIRE_EQUAL(8, global["ram_gift_kbytes"].as_uint64());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(onblock_keeps_recent_blocks, gxc_system_tester) try {
+   produce_blocks(300);
+
+   // onblock of a block sees the header of its previous block
+   auto last = get_last_block()["block_num"].as_uint64();
+   BOOST_REQUIRE_EQUAL(control->head_block_num() - 1, last);
+
+   for (uint32_t n = last; n > last - 256; --n) {
+      auto b = get_recent_block(n);
+      BOOST_REQUIRE_EQUAL(n, b["block_num"].as_uint64());
+      BOOST_REQUIRE_EQUAL(control->fetch_block_by_number(n)->id().str(), b["id"].as_string());
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(onblock_upgrades_last_block, gxc_system_tester) try {
+   // rows as written before recentblocks, lastblock without block number and singleton of the full header
+   set_table_row(config::system_account_name, config::system_account_name, N(lastblock), N(lastblock).value, "last_block", mvo()
+      ("last_block_num", get_last_block()["last_block_num"])
+   );
+   set_table_row(config::system_account_name, config::system_account_name, N(block), N(block).value, bytes(200, 'x'));
+   BOOST_REQUIRE(!get_last_block().get_object().contains("block_num"));
+
+   produce_blocks(1);
+   BOOST_REQUIRE_EQUAL(control->head_block_num() - 1, get_last_block()["block_num"].as_uint64());
+   BOOST_REQUIRE(get_row_by_account(config::system_account_name, config::system_account_name, N(block), N(block).value).empty());
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(user_account_without_userres, gxc_system_tester) try {
+   BOOST_REQUIRE_EQUAL(success(), genaccount(N(conr2d), N(player11111), "player1"));
+   BOOST_REQUIRE(get_userres(N(player11111)).is_null());
+
+   int64_t ram, net, cpu;
+   control->get_resource_limits_manager().get_account_limits(N(player11111), ram, net, cpu);
+   BOOST_REQUIRE_EQUAL(8 * 1024, ram);
+   BOOST_REQUIRE_EQUAL(0, net);
+   BOOST_REQUIRE_EQUAL(0, cpu);
+
+   // missing row is taken as zero resources
+   BOOST_REQUIRE_EQUAL(success(), setalimits(N(player11111), 1024, 10, 10));
+   BOOST_REQUIRE(get_userres(N(player11111)).is_null());
+   BOOST_REQUIRE(get_table_row(config::system_account_name, N(player11111), N(resmod), N(player11111).value, "user_resources").is_null());
+   control->get_resource_limits_manager().get_account_limits(N(player11111), ram, net, cpu);
+   BOOST_REQUIRE_EQUAL(9 * 1024, ram);
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(genaccounts_tests, gxc_system_tester) try {
+   auto trace = base_tester::push_action(config::system_account_name, N(genaccounts), N(conr2d),
+      genaccounts_args(N(conr2d), {{N(player11111), "player1"}, {N(player22222), "player2"}, {N(player33333), "player3"}}));
+
+   // a newaccount per account and a setnicks for all
+   size_t newaccounts = 0, setnicks = 0;
+   for (auto& at: trace->action_traces) {
+      if (at.act.name == N(newaccount)) newaccounts++;
+      if (at.act.name == N(setnicks)) setnicks++;
+   }
+   BOOST_REQUIRE_EQUAL(3, newaccounts);
+   BOOST_REQUIRE_EQUAL(1, setnicks);
+
+   BOOST_REQUIRE_EQUAL("player1", get_nickname(N(player11111)).as_string());
+   BOOST_REQUIRE_EQUAL("player2", get_nickname(N(player22222)).as_string());
+   BOOST_REQUIRE_EQUAL("player3", get_nickname(N(player33333)).as_string());
+   BOOST_REQUIRE(get_userres(N(player22222)).is_null());
+
+   // nickname is unique within a batch and against existing ones
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("nickname already taken"),
+      genaccounts(N(conr2d), {{N(player44444), "player4"}, {N(player55555), "player4"}}));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("nickname already taken"),
+      genaccounts(N(conr2d), {{N(player44444), "player4"}, {N(player55555), "player1"}}));
+   BOOST_REQUIRE(!control->db().find<account_object,by_name>(N(player44444)));
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("nickname has invalid length"), genaccounts(N(conr2d), {{N(player44444), "p4"}}));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no account to create"), genaccounts(N(conr2d), {}));
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(setalimitsv_tests, gxc_system_tester) try {
+   BOOST_REQUIRE_EQUAL(success(), genaccounts(N(conr2d), {{N(player11111), "player1"}, {N(player22222), "player2"}}));
+   BOOST_REQUIRE_EQUAL(success(), setramgift(4));
+
+   BOOST_REQUIRE_EQUAL(success(), setalimitsv({
+      {N(player11111), 1024, 10, 20},
+      {N(player22222), -1, -1, -1}
+   }));
+
+   // gift is added to every account with limited ram, as setalimits does
+   int64_t ram, net, cpu;
+   control->get_resource_limits_manager().get_account_limits(N(player11111), ram, net, cpu);
+   BOOST_REQUIRE_EQUAL(5 * 1024, ram);
+   BOOST_REQUIRE_EQUAL(10, net);
+   BOOST_REQUIRE_EQUAL(20, cpu);
+
+   control->get_resource_limits_manager().get_account_limits(N(player22222), ram, net, cpu);
+   BOOST_REQUIRE_EQUAL(-1, ram);
+   BOOST_REQUIRE_EQUAL(-1, net);
+   BOOST_REQUIRE_EQUAL(-1, cpu);
+
+   BOOST_REQUIRE_EQUAL(success(), setalimitsv({}));
+   BOOST_REQUIRE_EQUAL("missing authority of eosio", push_action(config::system_account_name, N(setalimitsv), N(conr2d), mvo()
+      ("limits", vector<variant>())
+   ));
+} FC_LOG_AND_RETHROW()
+
+// Reports elapsed time of onblock by the size of producer schedule. The header carrying
+// new producers is the largest one onblock hashes.
+BOOST_AUTO_TEST_CASE(onblock_cpu_by_schedule, BENCHMARK) try {
+   const uint32_t blocks = 50;
+
+   std::cout << "system onblock: " << blocks << " blocks after setprods" << std::endl;
+   std::cout << "   producers   avg(us)   max(us)" << std::endl;
+
+   for (uint32_t count: {1, 21, 63, 125}) {
+      gxc_system_tester t;
+
+      vector<account_name> producers;
+      for (uint32_t i = 0; i < count; ++i) {
+         producers.emplace_back(string("producer") + char('a' + i / 26) + char('a' + i % 26));
+      }
+      t.create_accounts(producers);
+      t.produce_blocks(1);
+
+      vector<int64_t> elapsed;
+      auto conn = t.control->applied_transaction.connect([&](std::tuple<const transaction_trace_ptr&, const signed_transaction&> x) {
+         const auto& trace = std::get<0>(x);
+         if (!trace->action_traces.empty() && trace->action_traces[0].act.name == N(onblock)) {
+            elapsed.emplace_back(trace->elapsed.count());
+         }
+      });
+
+      t.set_producers(producers);
+      t.produce_blocks(blocks);
+      conn.disconnect();
+
+      BOOST_REQUIRE(!elapsed.empty());
+      int64_t total = 0, max = 0;
+      for (auto e: elapsed) {
+         total += e;
+         max = std::max(max, e);
+      }
+      std::cout << std::setw(12) << count << std::setw(10) << total / int64_t(elapsed.size()) << std::setw(10) << max << std::endl;
+
+      // block ids match chain including the header carrying new producers
+      auto last = t.get_last_block()["block_num"].as_uint64();
+      for (auto n = last; n > last - blocks; --n) {
+         BOOST_REQUIRE_EQUAL(t.control->fetch_block_by_number(n)->id().str(), t.get_recent_block(n)["id"].as_string());
+      }
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -88,6 +88,58 @@ public:
       return data.empty() ? fc::variant() : abi_ser[code].binary_to_variant(type.empty() ? table.to_string() : type, data, abi_serializer_max_time);
    }
 
+   // first row of table matching pred, for rows looked up by secondary key
+   template<typename Predicate>
+   fc::variant find_table_row(const account_name& code, const account_name& scope, const account_name& table, const string& type, Predicate&& pred) {
+      const auto& db = control->db();
+      const auto* t_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+      if (!t_id) return fc::variant();
+
+      const auto& idx = db.get_index<key_value_index, by_scope_primary>();
+      for (auto itr = idx.lower_bound(boost::make_tuple(t_id->id, 0)); itr != idx.end() && itr->t_id == t_id->id; ++itr) {
+         vector<char> data(itr->value.data(), itr->value.data() + itr->value.size());
+         auto row = abi_ser[code].binary_to_variant(type.empty() ? table.to_string() : type, data, abi_serializer_max_time);
+         if (pred(row)) return row;
+      }
+      return fc::variant();
+   }
+
+   // writes a row as if the contract had stored it, for rows of a layout no longer written by the contract
+   void set_table_row(const account_name& code, const account_name& scope, const account_name& table, uint64_t primary_key, const string& type, const fc::variant& row) {
+      set_table_row(code, scope, table, primary_key, abi_ser[code].variant_to_binary(type, row, abi_serializer_max_time));
+   }
+
+   void set_table_row(const account_name& code, const account_name& scope, const account_name& table, uint64_t primary_key, const bytes& data) {
+      auto& db = control->mutable_db();
+      const auto* t_id = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+      if (!t_id) {
+         t_id = &db.create<table_id_object>([&](auto& t) {
+            t.code = code;
+            t.scope = scope;
+            t.table = table;
+            t.payer = code;
+         });
+      }
+
+      const auto* o = db.find<key_value_object, by_scope_primary>(boost::make_tuple(t_id->id, primary_key));
+      if (o) {
+         db.modify(*o, [&](auto& r) {
+            r.value.assign(data.data(), data.size());
+         });
+         return;
+      }
+
+      db.create<key_value_object>([&](auto& r) {
+         r.t_id = t_id->id;
+         r.primary_key = primary_key;
+         r.value.assign(data.data(), data.size());
+         r.payer = code;
+      });
+      db.modify(*t_id, [](auto& t) {
+         ++t.count;
+      });
+   }
+
    fc::variant get_stats(const string& symbol_name) {
       auto symbol_code = SC(symbol_name);
       return get_table_row(token_account_name, symbol_code.contract, N(stat), symbol_code.code);
@@ -98,6 +150,11 @@ public:
       return get_table_row(token_account_name, acc, N(accounts), XXH64((const void*)&symbol_code, sizeof(extended_symbol_code), 0));
    }
 
+   int64_t get_balance(account_name acc, const string& symbol_name) {
+      auto row = get_account(acc, symbol_name);
+      return row.is_null() ? 0 : asset::from_string(row["balance"].as_string()).get_amount();
+   }
+
    action_result push_action(const account_name& code, const account_name& acttype, const account_name& actor, const variant_object& data) {
       string action_type_name = abi_ser[code].get_action_type(acttype);
 
@@ -109,6 +166,15 @@ public:
       return base_tester::push_action(std::move(act), uint64_t(actor));
    }
 
+   // pushes an action in its own transaction, to get its trace
+   transaction_trace_ptr push_trx(account_name code, account_name act, account_name actor, const variant_object& data) {
+      signed_transaction trx;
+      trx.actions.emplace_back(get_action(code, act, vector<permission_level>{{actor, config::active_name}}, data));
+      set_transaction_headers(trx);
+      trx.sign(get_private_key(actor, "active"), control->get_chain_id());
+      return push_transaction(trx);
+   }
+
    void _set_code(account_name account, const vector<uint8_t> wasm) try {
       base_tester::push_action(config::system_account_name, N(setcode),
          vector<permission_level>{{account, config::active_name}, {config::system_account_name, config::active_name}},
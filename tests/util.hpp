@@ -1,5 +1,7 @@
 #pragma once
 #include <eosio/chain/asset.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
 
 namespace eosio { namespace chain {
 
@@ -67,3 +69,13 @@ inline std::string to_string(const fc::variant& v) {
 }
 
 }
+
+// Benchmarks and stress tests only report figures and take a while, so they are skipped
+// unless GXC_BENCHMARK is set, e.g. `GXC_BENCHMARK=1 ctest -R bancor_stress`.
+inline boost::test_tools::assertion_result benchmark_enabled(boost::unit_test::test_unit_id) {
+   boost::test_tools::assertion_result result(std::getenv("GXC_BENCHMARK") != nullptr);
+   result.message() << "set GXC_BENCHMARK to run";
+   return result;
+}
+
+#define BENCHMARK *boost::unit_test::precondition(benchmark_enabled)
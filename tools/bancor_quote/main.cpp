@@ -0,0 +1,90 @@
+#include "quote_engine.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace gxc::bancor_quote;
+
+static void usage(const char* prog) {
+   std::cerr << "usage: " << prog << " <connectors>\n"
+             << "\n"
+             << "Quotes bancor conversions read from stdin with the math of bancor contract.\n"
+             << "\n"
+             << "  connectors  file with a connector per line (raw amounts):\n"
+             << "              supply balance weight smart_precision connected_precision reserve_rate fee_rate fee_fixed\n"
+             << "  stdin       a request per line: connector_index side amount\n"
+             << "              side is one of buy, buy_exact, sell, sell_exact\n"
+             << "\n"
+             << "Prints `connected smart fee balance claimed` per request, or `error <message>`.\n";
+}
+
+static bool skip_line(const std::string& line) {
+   auto pos = line.find_first_not_of(" \t");
+   return pos == std::string::npos || line[pos] == '#';
+}
+
+int main(int argc, char** argv) {
+   if (argc != 2) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   std::ifstream in(argv[1]);
+   if (!in) {
+      std::cerr << "cannot open " << argv[1] << "\n";
+      return 1;
+   }
+
+   book b;
+   std::string line;
+   for (size_t lineno = 1; std::getline(in, line); ++lineno) {
+      if (skip_line(line)) continue;
+
+      std::istringstream ss(line);
+      pool p;
+      charge c;
+      unsigned sp, cp, rate;
+      if (!(ss >> p.supply >> p.balance >> p.weight >> sp >> cp >> p.reserve_rate >> rate >> c.fixed)) {
+         std::cerr << argv[1] << ":" << lineno << ": malformed connector\n";
+         return 1;
+      }
+      p.smart_precision = static_cast<uint8_t>(sp);
+      p.connected_precision = static_cast<uint8_t>(cp);
+      c.rate = static_cast<uint16_t>(rate);
+      b.add(p, c);
+   }
+
+   std::vector<request> requests;
+   for (size_t lineno = 1; std::getline(std::cin, line); ++lineno) {
+      if (skip_line(line)) continue;
+
+      std::istringstream ss(line);
+      request r;
+      std::string s;
+      if (!(ss >> r.connector >> s >> r.amount) || !side_from_string(s, r.type) || r.connector >= b.size()) {
+         std::cerr << "stdin:" << lineno << ": malformed request\n";
+         return 1;
+      }
+      requests.push_back(r);
+   }
+
+   std::vector<quote> quotes;
+   auto start = std::chrono::steady_clock::now();
+   quote_batch(b, requests, quotes);
+   auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   for (const auto& q: quotes) {
+      if (q.error) {
+         std::cout << "error " << q.error << "\n";
+      } else {
+         std::cout << q.connected << " " << q.smart << " " << q.fee << " " << q.balance << " " << q.claimed << "\n";
+      }
+   }
+
+   std::cerr << quotes.size() << " quotes in " << elapsed << " s";
+   if (elapsed > 0) std::cerr << " (" << uint64_t(quotes.size() / elapsed) << " quotes/s)";
+   std::cerr << "\n";
+   return 0;
+}
@@ -0,0 +1,109 @@
+#include "quote_engine.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace gxc { namespace bancor_quote {
+
+bool side_from_string(const std::string& s, side& out) {
+   if (s == "buy") out = side::buy;
+   else if (s == "buy_exact") out = side::buy_exact;
+   else if (s == "sell") out = side::sell;
+   else if (s == "sell_exact") out = side::sell_exact;
+   else return false;
+   return true;
+}
+
+void book::reserve(size_t n) {
+   supply.reserve(n);
+   balance.reserve(n);
+   weight.reserve(n);
+   reserve_rate.reserve(n);
+   smart_precision.reserve(n);
+   connected_precision.reserve(n);
+   charges.reserve(n);
+}
+
+size_t book::add(const pool& p, const charge& c) {
+   supply.push_back(p.supply);
+   balance.push_back(p.balance);
+   weight.push_back(p.weight);
+   reserve_rate.push_back(p.reserve_rate);
+   smart_precision.push_back(p.smart_precision);
+   connected_precision.push_back(p.connected_precision);
+   charges.push_back(c);
+   return size() - 1;
+}
+
+namespace {
+
+// Side is resolved at compile time, so the loop calls a single quote function per connector
+// instead of dispatching on side for every element. The loop is still scalar: the quote
+// functions branch on reserve rate and fee, and float operations are kept in the order
+// the contract runs them (no -ffast-math), as quotes must match the contract bit for bit.
+template<quote (*Fn)(const pool&, const charge&, int64_t)>
+void quote_loop(const book& b, const int64_t* amounts, quote* out) {
+   const size_t n = b.size();
+   const double*  supply  = b.supply.data();
+   const double*  balance = b.balance.data();
+   const double*  weight  = b.weight.data();
+   const double*  rate    = b.reserve_rate.data();
+   const uint8_t* sp      = b.smart_precision.data();
+   const uint8_t* cp      = b.connected_precision.data();
+   const charge*  charges = b.charges.data();
+
+   for (size_t i = 0; i < n; ++i) {
+      out[i] = Fn(pool{ supply[i], balance[i], weight[i], sp[i], cp[i], rate[i] }, charges[i], amounts[i]);
+   }
+}
+
+}
+
+void quote_all(const book& b, side s, const int64_t* amounts, quote* out) {
+   switch (s) {
+      case side::buy:        quote_loop<bancor_math::buy>(b, amounts, out); break;
+      case side::buy_exact:  quote_loop<bancor_math::buy_exact>(b, amounts, out); break;
+      case side::sell:       quote_loop<bancor_math::sell>(b, amounts, out); break;
+      case side::sell_exact: quote_loop<bancor_math::sell_exact>(b, amounts, out); break;
+   }
+}
+
+void quote_batch(const book& b, const std::vector<request>& requests, std::vector<quote>& out) {
+   out.resize(requests.size());
+
+   // group requests by side, keeping the order within each group
+   std::vector<size_t> order(requests.size());
+   std::iota(order.begin(), order.end(), 0);
+   std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+      return requests[l].type < requests[r].type;
+   });
+
+   book gathered;
+   std::vector<int64_t> amounts;
+   std::vector<quote> quoted;
+
+   for (size_t begin = 0; begin < order.size(); ) {
+      auto s = requests[order[begin]].type;
+      size_t end = begin;
+      while (end < order.size() && requests[order[end]].type == s) ++end;
+
+      gathered = book();
+      gathered.reserve(end - begin);
+      amounts.resize(end - begin);
+      for (size_t i = begin; i < end; ++i) {
+         const auto& r = requests[order[i]];
+         gathered.add(b.get_pool(r.connector), b.charges[r.connector]);
+         amounts[i - begin] = r.amount;
+      }
+
+      quoted.resize(end - begin);
+      quote_all(gathered, s, amounts.data(), quoted.data());
+      for (size_t i = begin; i < end; ++i) {
+         out[order[i]] = quoted[i - begin];
+      }
+
+      begin = end;
+   }
+}
+
+} } /// namespace gxc::bancor_quote
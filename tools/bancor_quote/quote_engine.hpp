@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../../contracts/include/contracts/bancor_math.hpp"
+
+namespace gxc { namespace bancor_quote {
+
+using bancor_math::pool;
+using bancor_math::charge;
+using bancor_math::quote;
+
+enum class side : uint8_t {
+   buy = 0,    // exact connected token in
+   buy_exact,  // exact smart token out
+   sell,       // exact smart token in
+   sell_exact  // exact connected token out
+};
+
+bool side_from_string(const std::string& s, side& out);
+
+/**
+ * Connectors laid out as structure of arrays, so that the quoting loop walks
+ * contiguous memory without dispatching on a row object.
+ */
+struct book {
+   std::vector<double>  supply;
+   std::vector<double>  balance;
+   std::vector<double>  weight;
+   std::vector<double>  reserve_rate;
+   std::vector<uint8_t> smart_precision;
+   std::vector<uint8_t> connected_precision;
+   std::vector<charge>  charges;
+
+   size_t size() const { return supply.size(); }
+
+   void reserve(size_t n);
+   size_t add(const pool& p, const charge& c);
+
+   pool get_pool(size_t i) const {
+      return { supply[i], balance[i], weight[i], smart_precision[i], connected_precision[i], reserve_rate[i] };
+   }
+};
+
+// quotes `amounts[i]` on connector `i` for every connector in the book
+void quote_all(const book& b, side s, const int64_t* amounts, quote* out);
+
+struct request {
+   uint32_t connector;
+   side     type;
+   int64_t  amount;
+};
+
+// quotes arbitrary requests, grouped by side before quoting
+void quote_batch(const book& b, const std::vector<request>& requests, std::vector<quote>& out);
+
+} } /// namespace gxc::bancor_quote
@@ -0,0 +1,141 @@
+#include "trace.hpp"
+#include "verifier.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+using namespace gxc::gacha_verify;
+
+static void usage(const char* prog) {
+   std::cerr << "usage: " << prog << " <scheme> [--threads N] [--simulate N [--pulls P]]\n"
+             << "\n"
+             << "Replays gacha draws with the drbg and grade selection of gacha contract.\n"
+             << "\n"
+             << "  scheme      JSON file of the opened scheme, grades in descending score with raw amounts:\n"
+             << "              {\"precision\": 1, \"budget\": 1000000,\n"
+             << "               \"grades\": [{\"score\": 192, \"reward\": 10000, \"limit\": 2}, ...]}\n"
+             << "  stdin       trace dump, a JSON object per line for every gacha in the order of draws:\n"
+             << "              {\"id\": 1, \"pulls\": 20, \"dseed\": \"<hex>\", \"oseed\": \"<hex>\",\n"
+             << "               \"block_ids\": [\"<hex>\", ...], \"scores\": [...]}\n"
+             << "              dseed is omitted for a gacha resolved after deadline, block_ids are only for\n"
+             << "              instant scheme, " << gxc::gacha_math::instant_blocks << " ids from the last block back, and scores are\n"
+             << "              of drawresult, if recorded\n"
+             << "  --simulate  draws N gachas of random seeds instead of reading stdin\n"
+             << "\n"
+             << "Exits with 2 if any drawn score differs from recorded scores.\n";
+}
+
+int main(int argc, char** argv) {
+   if (argc < 2) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+   uint64_t simulate = 0;
+   uint32_t sim_pulls = 1;
+   for (int i = 2; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (i + 1 == argc) {
+         usage(argv[0]);
+         return 1;
+      }
+      std::string value = argv[++i];
+      bool valid = false;
+      if (arg == "--threads") valid = parse_number(value, threads) && threads > 0;
+      else if (arg == "--simulate") valid = parse_number(value, simulate);
+      else if (arg == "--pulls") valid = parse_number(value, sim_pulls) && sim_pulls > 0 && sim_pulls <= 0xffff;
+      else {
+         usage(argv[0]);
+         return 1;
+      }
+      if (!valid) {
+         std::cerr << "invalid value for " << arg << ": " << value << "\n";
+         return 1;
+      }
+   }
+
+   scheme s;
+   try {
+      std::ifstream in(argv[1]);
+      if (!in) throw std::invalid_argument("cannot open file");
+      s = read_scheme(in);
+   } catch (const std::exception& e) {
+      std::cerr << argv[1] << ": malformed scheme: " << e.what() << "\n";
+      return 1;
+   }
+
+   std::vector<ticket> tickets;
+   if (simulate) {
+      std::mt19937_64 rng(std::random_device{}());
+      tickets.resize(simulate);
+      for (uint64_t i = 0; i < simulate; ++i) {
+         auto& t = tickets[i];
+         t.id = i;
+         t.pulls = static_cast<uint16_t>(sim_pulls);
+         for (auto& b: t.dseed) b = static_cast<uint8_t>(rng());
+         for (auto& b: t.oseed) b = static_cast<uint8_t>(rng());
+      }
+   } else {
+      std::string line;
+      for (size_t lineno = 1; std::getline(std::cin, line); ++lineno) {
+         if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+         try {
+            tickets.push_back(parse_ticket(line));
+         } catch (const std::exception& e) {
+            std::cerr << "stdin:" << lineno << ": malformed gacha: " << e.what() << "\n";
+            return 1;
+         }
+      }
+   }
+
+   std::vector<size_t> offsets;
+   std::vector<int64_t> scores;
+   auto start = std::chrono::steady_clock::now();
+   draw_all(tickets, s.precision, threads, offsets, scores);
+   auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   grader g(s);
+   uint64_t mismatched = 0, exceeded_at = 0;
+   for (size_t i = 0; i < tickets.size(); ++i) {
+      const auto& t = tickets[i];
+      for (uint16_t pull = 0; pull < t.pulls; ++pull) {
+         auto score = scores[offsets[i] + pull];
+         if (!t.recorded.empty() && t.recorded[pull] != score) {
+            if (mismatched++ < 10) {
+               std::cerr << "gacha " << t.id << " pull " << pull << ": drawn " << score
+                         << ", recorded " << t.recorded[pull] << "\n";
+            }
+         }
+         g.draw(score);
+         if (!exceeded_at && g.out() > s.budget) exceeded_at = offsets[i] + pull + 1;
+      }
+   }
+
+   const auto total = scores.size();
+   std::cout << tickets.size() << " gachas, " << total << " pulls\n";
+   std::cout << "   grade   score        reward       count    ratio\n";
+   for (size_t i = 0; i < g.grades().size(); ++i) {
+      const auto& gr = g.grades()[i];
+      std::cout << "   " << std::setw(5) << i << std::setw(8) << gr.score << std::setw(14) << gr.reward
+                << std::setw(12) << g.counts()[i] << std::setw(9) << std::fixed << std::setprecision(4)
+                << (total ? double(g.counts()[i]) / total : 0.) << "\n";
+   }
+   std::cout << "   raincheck                    " << std::setw(12) << g.rainchecks() << "\n";
+   std::cout << "   out " << g.out() << " of budget " << s.budget;
+   if (total) std::cout << ", " << std::setprecision(2) << double(g.out()) / total << " per pull";
+   std::cout << "\n";
+   if (exceeded_at) std::cout << "   budget exceeded at pull " << exceeded_at << ", where the draw aborts\n";
+   if (!simulate) std::cout << "   mismatched scores " << mismatched << "\n";
+
+   std::cerr << total << " pulls drawn in " << std::setprecision(3) << elapsed << " s with " << threads << " threads";
+   if (elapsed > 0) std::cerr << " (" << uint64_t(total / elapsed) << " pulls/s)";
+   std::cerr << "\n";
+   return mismatched ? 2 : 0;
+}
@@ -0,0 +1,92 @@
+#include "trace.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <sstream>
+#include <stdexcept>
+
+namespace gxc { namespace gacha_verify {
+
+namespace pt = boost::property_tree;
+
+template<typename T>
+static T get_number(const pt::ptree& tree, const std::string& path) {
+   auto value = tree.get<std::string>(path);
+   T out;
+   if (!parse_number(value, out)) throw std::invalid_argument("invalid " + path + " `" + value + "`");
+   return out;
+}
+
+static checksum get_checksum(const pt::ptree& tree, const std::string& path) {
+   auto value = tree.get<std::string>(path);
+   checksum out;
+   if (!checksum_from_hex(value, out)) throw std::invalid_argument("invalid " + path + " `" + value + "`");
+   return out;
+}
+
+scheme read_scheme(std::istream& in) {
+   pt::ptree tree;
+   pt::read_json(in, tree);
+
+   scheme s;
+   auto precision = get_number<unsigned>(tree, "precision");
+   if (precision < 1 || precision > 4) throw std::invalid_argument("precision should be 1 to 4");
+   s.precision = static_cast<uint8_t>(precision);
+   s.budget = get_number<int64_t>(tree, "budget");
+
+   for (const auto& child: tree.get_child("grades")) {
+      grade g;
+      g.score = get_number<uint32_t>(child.second, "score");
+      g.reward = get_number<int64_t>(child.second, "reward");
+      if (child.second.count("limit")) g.limit = get_number<uint32_t>(child.second, "limit");
+      if (!s.grades.empty() && s.grades.back().score <= g.score) {
+         throw std::invalid_argument("grades should be sorted in descending order by score");
+      }
+      s.grades.push_back(g);
+   }
+   return s;
+}
+
+ticket parse_ticket(const std::string& line) {
+   std::istringstream ss(line);
+   pt::ptree tree;
+   pt::read_json(ss, tree);
+
+   ticket t;
+   t.id = get_number<uint64_t>(tree, "id");
+   auto pulls = get_number<uint32_t>(tree, "pulls");
+   if (pulls == 0 || pulls > 0xffff) throw std::invalid_argument("pulls should be 1 to 65535");
+   t.pulls = static_cast<uint16_t>(pulls);
+
+   if (tree.count("dseed")) {
+      t.dseed = get_checksum(tree, "dseed");
+      t.oseed = get_checksum(tree, "oseed");
+   } else {
+      t.expired = true;
+   }
+   if (tree.count("block_ids")) {
+      for (const auto& child: tree.get_child("block_ids")) {
+         checksum id;
+         if (!checksum_from_hex(child.second.data(), id)) {
+            throw std::invalid_argument("invalid block id `" + child.second.data() + "`");
+         }
+         t.block_ids.push_back(id);
+      }
+      if (t.block_ids.size() != gacha_math::instant_blocks) throw std::invalid_argument("number of block ids differs from instant_blocks");
+   }
+
+   if (tree.count("scores")) {
+      for (const auto& child: tree.get_child("scores")) {
+         int64_t score;
+         if (!parse_number(child.second.data(), score)) {
+            throw std::invalid_argument("invalid score `" + child.second.data() + "`");
+         }
+         t.recorded.push_back(score);
+      }
+      if (t.recorded.size() != t.pulls) throw std::invalid_argument("number of scores differs from pulls");
+   }
+   return t;
+}
+
+} }
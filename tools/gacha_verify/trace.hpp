@@ -0,0 +1,25 @@
+#pragma once
+
+#include "verifier.hpp"
+
+#include <charconv>
+#include <istream>
+#include <string>
+
+namespace gxc { namespace gacha_verify {
+
+// the whole of `s` as a decimal T, without a sign T can't hold and within the range of T
+template<typename T>
+bool parse_number(const std::string& s, T& out) {
+   auto last = s.data() + s.size();
+   auto res = std::from_chars(s.data(), last, out);
+   return !s.empty() && res.ec == std::errc() && res.ptr == last;
+}
+
+// scheme from its JSON, throws on malformed input
+scheme read_scheme(std::istream& in);
+
+// ticket from a line of trace dump, throws on malformed input
+ticket parse_ticket(const std::string& line);
+
+} }
@@ -0,0 +1,105 @@
+#include "verifier.hpp"
+
+#include <eostd/crypto/drbg.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace gxc { namespace gacha_verify {
+
+bool checksum_from_hex(const std::string& s, checksum& out) {
+   if (s.size() != out.size() * 2) return false;
+
+   auto nibble = [](char c) -> int {
+      if (c >= '0' && c <= '9') return c - '0';
+      if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+      if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+      return -1;
+   };
+   for (size_t i = 0; i < out.size(); ++i) {
+      int hi = nibble(s[2*i]), lo = nibble(s[2*i+1]);
+      if (hi < 0 || lo < 0) return false;
+      out[i] = uint8_t(hi << 4 | lo);
+   }
+   return true;
+}
+
+void draw_scores(const ticket& t, uint8_t precision, int64_t* out) {
+   if (t.expired) {
+      std::fill(out, out + t.pulls, -1);
+      return;
+   }
+
+   // dseed || oseed, followed by ids of recent blocks for instant scheme
+   eostd::byte seed[64 + 32 * gacha_math::instant_blocks];
+   size_t size = 0;
+   std::memcpy(seed + size, t.dseed.data(), 32); size += 32;
+   std::memcpy(seed + size, t.oseed.data(), 32); size += 32;
+   for (const auto& id: t.block_ids) {
+      std::memcpy(seed + size, id.data(), 32); size += 32;
+   }
+
+   eostd::hash_drbg drbg(seed, size);
+   for (uint16_t pull = 0; pull < t.pulls; ++pull) {
+      eostd::byte result[gacha_math::bytes_per_pull];
+      drbg.generate_block(&result[0], sizeof(result));
+      out[pull] = gacha_math::to_score(reinterpret_cast<const uint8_t*>(result), precision);
+   }
+}
+
+void draw_all(const std::vector<ticket>& tickets, uint8_t precision, unsigned threads,
+              std::vector<size_t>& offsets, std::vector<int64_t>& scores) {
+   offsets.resize(tickets.size() + 1);
+   offsets[0] = 0;
+   for (size_t i = 0; i < tickets.size(); ++i) offsets[i+1] = offsets[i] + tickets[i].pulls;
+   scores.resize(offsets.back());
+
+   threads = std::max(1u, std::min<unsigned>(threads, tickets.size()));
+   const size_t shard = (tickets.size() + threads - 1) / std::max(1u, threads);
+
+   std::vector<std::thread> workers;
+   for (unsigned w = 0; w < threads; ++w) {
+      size_t first = w * shard, last = std::min(tickets.size(), first + shard);
+      if (first >= last) break;
+      workers.emplace_back([&, first, last] {
+         for (size_t i = first; i < last; ++i) draw_scores(tickets[i], precision, scores.data() + offsets[i]);
+      });
+   }
+   for (auto& w: workers) w.join();
+}
+
+grader::grader(const scheme& s)
+: _grades(s.grades)
+, _counts(s.grades.size())
+, _budget(s.budget) {
+}
+
+int32_t grader::draw(int64_t score) {
+   // drawn scores skip grades by limit only, and gacha resolved without dseed also skips grades the rest of budget can't pay
+   auto is_exhausted = [&](const grade& g) {
+      return (g.limit && g.out_count >= *g.limit) || (score < 0 && g.reward > _budget - _out);
+   };
+
+   // gacha resolved without dseed gets the highest grade still available
+   auto lower = _grades.begin();
+   if (score >= 0) {
+      lower = std::lower_bound(_grades.begin(), _grades.end(), gacha_math::key_of(static_cast<uint32_t>(score)),
+         [](const grade& g, uint64_t key) { return gacha_math::key_of(g.score) < key; });
+   }
+   auto it = gacha_math::select(lower, _grades.end(), is_exhausted);
+
+   if (it == _grades.end()) {
+      _rainchecks++;
+      return -1;
+   }
+
+   it->out_count++;
+   _out += it->reward;
+
+   auto index = static_cast<int32_t>(it - _grades.begin());
+   _counts[index]++;
+   return index;
+}
+
+} } /// namespace gxc::gacha_verify
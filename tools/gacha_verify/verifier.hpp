@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../../contracts/include/contracts/gacha_math.hpp"
+
+namespace gxc { namespace gacha_verify {
+
+using checksum = std::array<uint8_t,32>;
+
+bool checksum_from_hex(const std::string& s, checksum& out);
+
+struct grade {
+   uint32_t                score;
+   int64_t                 reward;        // raw amount
+   std::optional<uint32_t> limit;
+   uint32_t                out_count = 0; // drawn before, counted toward limit
+};
+
+// grades in descending order by score, as opened
+struct scheme {
+   uint8_t            precision = 1;
+   int64_t            budget = 0;
+   std::vector<grade> grades;
+};
+
+struct ticket {
+   uint64_t                id = 0;
+   uint16_t                pulls = 1;
+   bool                    expired = false; // resolved after deadline without dseed
+   checksum                dseed{};
+   checksum                oseed{};
+   std::vector<checksum>   block_ids;       // ids of recent blocks from the last one, for instant scheme
+   std::vector<int64_t>    recorded;        // scores of drawresult, if dumped
+};
+
+// scores of every pull of `t`, as drawn by gacha contract
+void draw_scores(const ticket& t, uint8_t precision, int64_t* out);
+
+// scores of every ticket sharded over `threads`, `offsets[i]` is the first score of `tickets[i]`
+void draw_all(const std::vector<ticket>& tickets, uint8_t precision, unsigned threads,
+              std::vector<size_t>& offsets, std::vector<int64_t>& scores);
+
+/**
+ * Assigns grades to scores in the order of draws, counting toward limits and budget.
+ * Grades depend on the draws before them once a limit or budget is reached, so this runs sequentially.
+ * out() may exceed the budget, where gacha contract aborts the draw instead.
+ */
+class grader {
+public:
+   explicit grader(const scheme& s);
+
+   // index of grade drawn by `score`, or -1 for raincheck
+   int32_t draw(int64_t score);
+
+   const std::vector<grade>&    grades() const { return _grades; }
+   const std::vector<uint64_t>& counts() const { return _counts; }
+   uint64_t rainchecks() const { return _rainchecks; }
+   int64_t  out() const { return _out; }
+
+private:
+   std::vector<grade>    _grades;
+   std::vector<uint64_t> _counts;
+   int64_t               _budget;
+   uint64_t              _rainchecks = 0;
+   int64_t               _out = 0;
+};
+
+} } /// namespace gxc::gacha_verify